@@ -0,0 +1,700 @@
+// Host benchmarks of the tiny_grafx primitives and the PCD8544 flush paths.
+//
+// Each workload runs on the host transport and reports ns/op and the bytes
+// sent to the display per frame. Results are compared with a baseline
+// file; the run fails when a workload is slower than the baseline by more
+// than the tolerance, or sends more bytes per frame.
+//
+//   bench [-b baseline] [-t tolerance] [-u]
+//     -b  baseline file (default: baseline.txt)
+//     -t  allowed slowdown factor for ns/op (default: 2.0)
+//     -u  write the results to the baseline file
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcd8544.h"
+#include "canvas.h"
+#include "console.h"
+#include "font.h"
+#include "rle.h"
+#include "anim.h"
+#include "dither.h"
+#include "tiny_grafx.h"
+
+#define MAX_RESULTS 32
+
+// The suite runs several times, the fastest time of each workload is kept
+#define ROUNDS 5
+
+typedef struct result_t {
+  char name[32];
+  double ns_per_op;
+  double bytes_per_frame;
+} result_t;
+
+static result_t results[MAX_RESULTS];
+static int result_count;
+
+static spi_config_t lcd;
+static uint32_t seed = 12345;
+
+// Deterministic pseudo random numbers, the same workload on every run
+static int16_t
+rnd(int16_t n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+record(const char *name, double ns, long ops, long bytes, long frames)
+{
+  result_t *r = NULL;
+
+  for (int i = 0; i < result_count; i++) {
+    if (strcmp(results[i].name, name) == 0) {
+      r = &results[i];
+    }
+  }
+  if (r == NULL) {
+    r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->ns_per_op = ns / ops;
+  }
+  if (ns / ops < r->ns_per_op) {
+    r->ns_per_op = ns / ops;
+  }
+  r->bytes_per_frame = frames ? (double)bytes / frames : 0;
+}
+
+// ----- drawing workloads -----
+
+static void
+bench_set_pixel(void)
+{
+  const long n = 1000000;
+  int16_t xy[1024][2];
+  for (int i = 0; i < 1024; i++) {
+    xy[i][0] = rnd(PCD8544_DISPLAY_WIDTH);
+    xy[i][1] = rnd(PCD8544_DISPLAY_HEIGHT);
+  }
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    set_pixel(&lcd.draw.tinygrafx, xy[i & 1023][0], xy[i & 1023][1], INVERT);
+  }
+  record("set_pixel", now_ns() - t, n, 0, 0);
+}
+
+// Spirograph lines of the README demo
+static void
+bench_spirograph(void)
+{
+  const int rc = 11, rm = 6, rd = 9;
+  const int steps = 189;
+  int16_t pts[190][2];
+  for (int i = 0; i <= steps; i++) {
+    double th = 0.2 * i;
+    pts[i][0] = (rc + rm) * cos(th) - rd * cos(th * (rc + rm) / rm) + 42;
+    pts[i][1] = (rc + rm) * sin(th) - rd * sin(th * (rc + rm) / rm) + 24;
+  }
+  const long rounds = 500;
+  double t = now_ns();
+  for (long r = 0; r < rounds; r++) {
+    for (int i = 0; i < steps; i++) {
+      draw_line(&lcd.draw.tinygrafx, pts[i][0], pts[i][1], pts[i + 1][0], pts[i + 1][1], INVERT);
+    }
+  }
+  record("draw_line", now_ns() - t, rounds * steps, 0, 0);
+}
+
+// Long lines of a scrolled plot, mostly outside a clip rectangle
+static void
+bench_line_clipped(void)
+{
+  const long n = 20000;
+  tinygrafx_t tg = lcd.draw.tinygrafx;
+  set_clip(&tg, 10, 8, 64, 32);
+  set_origin(&tg, -200, 0);
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    int16_t x = rnd(400);
+    draw_line(&tg, x, rnd(48), x + 100, rnd(48), INVERT);
+  }
+  record("line_clipped", now_ns() - t, n, 0, 0);
+}
+
+static void
+bench_fill_screen(void)
+{
+  const long n = 50000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    draw_fill_rect(&lcd.draw.tinygrafx, 0, 0, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, (i & 1) ? WHITE : BLACK);
+  }
+  record("fill_rect_screen", now_ns() - t, n, 0, 0);
+}
+
+static void
+bench_fill_rect_bars(void)
+{
+  const long n = 100000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    int16_t h = rnd(PCD8544_DISPLAY_HEIGHT);
+    draw_fill_rect(&lcd.draw.tinygrafx, (i % 12) * 7, PCD8544_DISPLAY_HEIGHT - h, 6, h, INVERT);
+  }
+  record("fill_rect_bars", now_ns() - t, n, 0, 0);
+}
+
+static void
+bench_fill_circle(void)
+{
+  const long n = 20000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    draw_fill_circle(&lcd.draw.tinygrafx, rnd(PCD8544_DISPLAY_WIDTH), rnd(PCD8544_DISPLAY_HEIGHT), 4 + rnd(16), INVERT);
+  }
+  record("fill_circle", now_ns() - t, n, 0, 0);
+}
+
+static void
+bench_fill_triangle(void)
+{
+  const long n = 20000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    int16_t x = rnd(PCD8544_DISPLAY_WIDTH), y = rnd(PCD8544_DISPLAY_HEIGHT);
+    draw_fill_triangle(&lcd.draw.tinygrafx, x, y, x + rnd(32) - 16, y + rnd(32) - 16, x + rnd(32) - 16, y + rnd(32) - 16, INVERT);
+  }
+  record("fill_triangle", now_ns() - t, n, 0, 0);
+}
+
+// A page of text, 6 lines of 10 characters
+static void
+bench_text_page(int16_t fontsize, const char *name)
+{
+  static const char *lines[] = {
+    "Temp 23.5C", "Humi 45.2%", "Pres  1013", "Wind  3m/s", "Rain   0mm", "Batt  3.9V"
+  };
+  const long n = 5000;
+  int16_t line_h = 8 * fontsize;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    for (int l = 0; l < 6; l++) {
+      display_text(&lcd.draw.tinygrafx, 0, l * line_h, (uint8_t *)lines[l], 10, WHITE, fontsize);
+    }
+  }
+  record(name, now_ns() - t, n, 0, 0);
+}
+
+// The same page in a proportional font
+static void
+bench_text_font(const font_t *font, const char *name)
+{
+  static const char *lines[] = {
+    "Temp 23.5C", "Humi 45.2%", "Pres  1013", "Wind  3m/s", "Rain   0mm", "Batt  3.9V"
+  };
+  const long n = 5000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    for (int l = 0; l < 6; l++) {
+      font_draw_text(&lcd.draw.tinygrafx, font, 0, l * font->line_height, (uint8_t *)lines[l], 10, WHITE);
+    }
+  }
+  record(name, now_ns() - t, n, 0, 0);
+}
+
+static void
+bench_sprites(void)
+{
+  uint8_t sprite[16];
+  for (int i = 0; i < 16; i++) {
+    sprite[i] = rnd(256);
+  }
+  const long n = 200000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    blit(&lcd.draw.tinygrafx, rnd(PCD8544_DISPLAY_WIDTH + 8) - 8, rnd(PCD8544_DISPLAY_HEIGHT + 16) - 16,
+         sprite, NULL, 8, 16, BLIT_XOR);
+  }
+  record("blit_sprite", now_ns() - t, n, 0, 0);
+}
+
+// Scroll a canvas with a partial last bank by dy and compare every pixel
+// with the pixel dy rows away, the rows scrolled in are BLACK
+static void
+check_scroll(int16_t height, int16_t dy)
+{
+  enum { W = 16 };
+  static uint8_t before[W][64];
+  canvas_t canvas;
+
+  if (canvas_open(&canvas, W, height) != ESP_OK) {
+    fprintf(stderr, "cannot open a %dx%d canvas\n", W, height);
+    exit(2);
+  }
+  const tinygrafx_t *tg = &canvas.draw.tinygrafx;
+  for (int16_t y = 0; y < height; y++) {
+    for (int16_t x = 0; x < W; x++) {
+      set_pixel(tg, x, y, rnd(2) ? WHITE : BLACK);
+      before[x][y] = get_pixel(tg, x, y);
+    }
+  }
+  scroll(tg, 0, dy, BLACK);
+  for (int16_t y = 0; y < height; y++) {
+    for (int16_t x = 0; x < W; x++) {
+      int16_t src = y - dy;
+      int16_t want = ((src >= 0) && (src < height)) ? before[x][src] : 0;
+      if (get_pixel(tg, x, y) != want) {
+        fprintf(stderr, "scroll mismatch: %dx%d canvas, dy=%d at %d,%d\n", W, height, dy, x, y);
+        exit(2);
+      }
+    }
+  }
+  canvas_close(&canvas);
+}
+
+// A ticker line moved one pixel left, and a log screen moved one row up
+static void
+bench_scroll(void)
+{
+  static const int16_t heights[] = { 13, 20, 61 };
+  for (int i = 0; i < 3; i++) {
+    check_scroll(heights[i], -2);
+    check_scroll(heights[i], 3);
+    check_scroll(heights[i], -9);
+  }
+
+  const long n = 100000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    scroll_region(&lcd.draw.tinygrafx, 0, 40, PCD8544_DISPLAY_WIDTH, 8, -1, 0, BLACK);
+  }
+  record("scroll_ticker", now_ns() - t, n, 0, 0);
+
+  t = now_ns();
+  for (long i = 0; i < n; i++) {
+    scroll(&lcd.draw.tinygrafx, 0, -1, BLACK);
+  }
+  record("scroll_log", now_ns() - t, n, 0, 0);
+}
+
+// A widget pre-rendered on a canvas, stamped on the frame
+static void
+bench_canvas(void)
+{
+  canvas_t widget;
+  if (canvas_open(&widget, 40, 16) != ESP_OK) return;
+  draw_fill_round_rect(&widget.draw.tinygrafx, 0, 0, 40, 16, 4, WHITE);
+  display_text(&widget.draw.tinygrafx, 4, 4, (uint8_t *)"mrb", 3, BLACK, 1);
+
+  const long n = 100000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    tinygrafx_t *w = &widget.draw.tinygrafx;
+    blit(&lcd.draw.tinygrafx, rnd(PCD8544_DISPLAY_WIDTH) - 20, rnd(PCD8544_DISPLAY_HEIGHT) - 8,
+         w->display_buffer, NULL, w->display_width, w->display_height, BLIT_COPY);
+  }
+  record("canvas_stamp", now_ns() - t, n, 0, 0);
+  canvas_close(&widget);
+}
+
+// A full screen image, blitted and decoded from RLE
+static void
+bench_image(void)
+{
+  static uint8_t image[PCD8544_DISPLAY_PIXEL];
+  static uint8_t rle[RLE_ENCODED_MAX(PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT)];
+  const tinygrafx_t *tg = &lcd.draw.tinygrafx;
+
+  buffer_clear(tg);
+  draw_fill_round_rect(tg, 0, 0, 84, 12, 3, WHITE);
+  display_text(tg, 6, 2, (uint8_t *)"STATUS", 6, BLACK, 1);
+  draw_fill_circle(tg, 20, 32, 10, WHITE);
+  draw_rect(tg, 40, 20, 40, 24, WHITE);
+  display_text(tg, 44, 28, (uint8_t *)"23.5", 4, WHITE, 1);
+  memcpy(image, tg->display_buffer, sizeof(image));
+  int32_t size = rle_encode(image, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, rle, sizeof(rle));
+
+  const long n = 100000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    blit(tg, 0, 0, image, NULL, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, BLIT_COPY);
+  }
+  record("image_blit", now_ns() - t, n, 0, 0);
+
+  t = now_ns();
+  for (long i = 0; i < n; i++) {
+    rle_draw(tg, 0, 0, rle, size, BLIT_COPY);
+  }
+  record("image_rle", now_ns() - t, n, 0, 0);
+}
+
+// A full screen 8-bit grayscale image, a gradient with noise like a sensor
+// heat map, converted with each dithering method
+static void
+bench_dither(void)
+{
+  static uint8_t gray[PCD8544_DISPLAY_WIDTH * PCD8544_DISPLAY_HEIGHT];
+  const tinygrafx_t *tg = &lcd.draw.tinygrafx;
+
+  for (int16_t y = 0; y < PCD8544_DISPLAY_HEIGHT; y++) {
+    for (int16_t x = 0; x < PCD8544_DISPLAY_WIDTH; x++) {
+      int16_t level = x * 3 + rnd(16);
+      gray[y * PCD8544_DISPLAY_WIDTH + x] = (level > 255) ? 255 : level;
+    }
+  }
+
+  const long n = 20000;
+  double t = now_ns();
+  for (long i = 0; i < n; i++) {
+    dither_draw(tg, 0, 0, gray, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, DITHER_BAYER);
+  }
+  record("dither_bayer", now_ns() - t, n, 0, 0);
+
+  t = now_ns();
+  for (long i = 0; i < n; i++) {
+    dither_draw(tg, 0, 0, gray, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, DITHER_DIFFUSION);
+  }
+  record("dither_diffusion", now_ns() - t, n, 0, 0);
+}
+
+// ----- flush workloads -----
+
+// The emulated display must show the frame the flush sent, a flush that
+// sends fewer but wrong bytes fails the run
+static void
+check_ddram(spi_config_t *panel, const char *name)
+{
+  const uint8_t *ddram = host_transport_ddram(panel);
+
+  if ((ddram == NULL) || memcmp(ddram, panel->front_buffer, panel->draw.tinygrafx.display_pixel)) {
+    fprintf(stderr, "%s: the display doesn't match the frame\n", name);
+    exit(2);
+  }
+}
+
+static void
+flush_frames(const char *name, uint8_t mode, long frames, void (*draw)(long))
+{
+  lcd.flush_mode = mode;
+  buffer_clear(&lcd.draw.tinygrafx);
+  pcd8544_send_display(&lcd);
+  pcd8544_wait(&lcd);
+  check_ddram(&lcd, name);
+
+  uint32_t bytes = lcd.stats.bytes;
+  double t = now_ns();
+  for (long i = 0; i < frames; i++) {
+    draw(i);
+    pcd8544_send_display(&lcd);
+    pcd8544_wait(&lcd);
+    check_ddram(&lcd, name);
+  }
+  record(name, now_ns() - t, frames, lcd.stats.bytes - bytes, frames);
+}
+
+// dashboard, a few digits change every frame
+static void
+draw_dashboard(long i)
+{
+  char digits[8];
+  snprintf(digits, sizeof(digits), "%03ld", i % 1000);
+  draw_fill_rect(&lcd.draw.tinygrafx, 48, 16, 24, 8, BLACK);
+  display_text(&lcd.draw.tinygrafx, 48, 16, (uint8_t *)digits, 3, WHITE, 1);
+}
+
+// a bar graph column changes every frame
+static void
+draw_bar(long i)
+{
+  draw_fill_rect(&lcd.draw.tinygrafx, 40, 0, 2, PCD8544_DISPLAY_HEIGHT, BLACK);
+  draw_fill_rect(&lcd.draw.tinygrafx, 40, PCD8544_DISPLAY_HEIGHT - (i % 48), 2, i % 48, WHITE);
+}
+
+// every pixel changes every frame
+static void
+draw_invert(long i)
+{
+  draw_fill_rect(&lcd.draw.tinygrafx, 0, 0, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, INVERT);
+}
+
+// four panels on a shared bus, a few digits change on each
+static void
+bench_bus(void)
+{
+  pcd8544_bus_t *bus = calloc(1, sizeof(pcd8544_bus_t));
+  spi_config_t panels[4];
+  const long frames = 5000;
+
+  memset(panels, 0, sizeof(panels));
+  if ((bus == NULL) || (pcd8544_bus_open(bus, TRANSPORT_HOST) != ESP_OK)) {
+    fprintf(stderr, "cannot open the host bus\n");
+    exit(2);
+  }
+  for (int p = 0; p < 4; p++) {
+    panels[p].bus = bus;
+    pcd8544_open(&panels[p], DRIVER_PCD8544, TRANSPORT_HOST);
+    panels[p].flush_mode = FLUSH_DIFF;
+  }
+  pcd8544_bus_display(bus);
+  for (int p = 0; p < 4; p++) {
+    pcd8544_reset_stats(&panels[p]);
+  }
+
+  double t = now_ns();
+  for (long i = 0; i < frames; i++) {
+    for (int p = 0; p < 4; p++) {
+      char digits[8];
+      snprintf(digits, sizeof(digits), "%03ld", (i + p) % 1000);
+      draw_fill_rect(&panels[p].draw.tinygrafx, 48, 16, 24, 8, BLACK);
+      display_text(&panels[p].draw.tinygrafx, 48, 16, (uint8_t *)digits, 3, WHITE, 1);
+    }
+    pcd8544_bus_display(bus);
+    for (int p = 0; p < 4; p++) {
+      check_ddram(&panels[p], "flush_bus_4panels");
+    }
+  }
+  double ns = now_ns() - t;
+
+  long bytes = 0;
+  for (int p = 0; p < 4; p++) {
+    bytes += panels[p].stats.bytes;
+    pcd8544_close(&panels[p]);
+  }
+  pcd8544_bus_release(bus);
+  record("flush_bus_4panels", ns, frames, bytes, frames);
+}
+
+// a console log, a counter line every frame and a new line every 8 frames,
+// flushed in full mode with only the changed banks
+static void
+bench_console(void)
+{
+  console_t con;
+  const long frames = 20000;
+
+  lcd.flush_mode = FLUSH_FULL;
+  console_open(&con, &lcd.draw.tinygrafx);
+  pcd8544_send_banks(&lcd, console_render(&con, &lcd.draw.tinygrafx));
+  pcd8544_wait(&lcd);
+  check_ddram(&lcd, "console_log");
+
+  uint32_t bytes = lcd.stats.bytes;
+  double t = now_ns();
+  for (long i = 0; i < frames; i++) {
+    char line[16];
+    int len = snprintf(line, sizeof(line), "\rt=%05ld%s", i, (i % 8 == 7) ? "\n" : "");
+    console_write(&con, &lcd.draw.tinygrafx, (uint8_t *)line, len);
+    pcd8544_send_banks(&lcd, console_render(&con, &lcd.draw.tinygrafx));
+    pcd8544_wait(&lcd);
+    check_ddram(&lcd, "console_log");
+  }
+  record("console_log", now_ns() - t, frames, lcd.stats.bytes - bytes, frames);
+}
+
+// a ball bouncing over a static frame, played as delta frames in full mode
+static void
+bench_anim(void)
+{
+  enum { FRAMES = 24 };
+  static uint8_t frames[FRAMES][PCD8544_DISPLAY_PIXEL];
+  static uint8_t data[ANIM_HEADER_SIZE + FRAMES * ANIM_FRAME_MAX(PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT)];
+  const tinygrafx_t *tg = &lcd.draw.tinygrafx;
+  int32_t len = anim_encode_header(data, sizeof(data), PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, FRAMES);
+
+  for (int f = 0; f < FRAMES; f++) {
+    int16_t bounce = (f < FRAMES / 2) ? f : (FRAMES - f);
+    buffer_clear(tg);
+    draw_rect(tg, 0, 0, PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT, WHITE);
+    display_text(tg, 2, 2, (uint8_t *)"BOOT", 4, WHITE, 1);
+    draw_fill_circle(tg, 10 + f * 3, 40 - bounce * 2, 5, WHITE);
+    memcpy(frames[f], tg->display_buffer, PCD8544_DISPLAY_PIXEL);
+    len += anim_encode_frame((f > 0) ? frames[f - 1] : NULL, frames[f], PCD8544_DISPLAY_WIDTH, PCD8544_DISPLAY_HEIGHT,
+                             data + len, sizeof(data) - len);
+  }
+
+  anim_t anim;
+  anim_stats_t st;
+  if (anim_open(&anim, data, len) != ESP_OK) return;
+  lcd.flush_mode = FLUSH_FULL;
+  const long loops = 500;
+  double t = now_ns();
+  anim_play(&lcd, &anim, 0, 0, 0, loops, &st);
+  record("anim_play", now_ns() - t, st.frames, st.bytes, st.shown);
+  check_ddram(&lcd, "anim_play");
+
+  // every frame once more, checking the display after each one
+  anim_rewind(&anim);
+  for (int f = 0; f < FRAMES; f++) {
+    uint8_t banks;
+    if (anim_next(&anim, tg, 0, 0, &banks) != ESP_OK) break;
+    pcd8544_send_banks(&lcd, banks);
+    pcd8544_wait(&lcd);
+    check_ddram(&lcd, "anim_play");
+  }
+}
+
+// the dashboard digits on a 128x64 SSD1306, the diff runs are addressed
+// with a column and page window
+static void
+bench_ssd1306(void)
+{
+  spi_config_t oled;
+  const long frames = 20000;
+
+  memset(&oled, 0, sizeof(oled));
+  if (pcd8544_open(&oled, DRIVER_SSD1306, TRANSPORT_HOST) != ESP_OK) {
+    fprintf(stderr, "cannot open the SSD1306 on the host transport\n");
+    exit(2);
+  }
+  oled.flush_mode = FLUSH_DIFF;
+  pcd8544_send_display(&oled);
+  pcd8544_wait(&oled);
+  check_ddram(&oled, "ssd1306_flush_diff");
+
+  uint32_t bytes = oled.stats.bytes;
+  double t = now_ns();
+  for (long i = 0; i < frames; i++) {
+    char digits[8];
+    snprintf(digits, sizeof(digits), "%03ld", i % 1000);
+    draw_fill_rect(&oled.draw.tinygrafx, 88, 24, 24, 8, BLACK);
+    display_text(&oled.draw.tinygrafx, 88, 24, (uint8_t *)digits, 3, WHITE, 1);
+    pcd8544_send_display(&oled);
+    pcd8544_wait(&oled);
+    check_ddram(&oled, "ssd1306_flush_diff");
+  }
+  record("ssd1306_flush_diff", now_ns() - t, frames, oled.stats.bytes - bytes, frames);
+  pcd8544_close(&oled);
+}
+
+static void
+bench_flush(void)
+{
+  flush_frames("flush_full", FLUSH_FULL, 20000, draw_dashboard);
+  flush_frames("flush_diff_digits", FLUSH_DIFF, 20000, draw_dashboard);
+  flush_frames("flush_diff_bar", FLUSH_DIFF, 20000, draw_bar);
+  flush_frames("flush_diff_screen", FLUSH_DIFF, 20000, draw_invert);
+  bench_console();
+  bench_anim();
+  bench_ssd1306();
+}
+
+// ----- baseline -----
+
+static int
+compare_baseline(const char *path, double tolerance)
+{
+  FILE *fp = fopen(path, "r");
+  char name[32];
+  double ns, bytes;
+  int failed = 0;
+
+  if (fp == NULL) {
+    printf("no baseline %s, run with -u to create it\n", path);
+    return 0;
+  }
+  while (fscanf(fp, "%31s %lf %lf", name, &ns, &bytes) == 3) {
+    for (int i = 0; i < result_count; i++) {
+      result_t *r = &results[i];
+      if (strcmp(r->name, name) != 0) continue;
+      if (r->ns_per_op > ns * tolerance) {
+        printf("REGRESSION %s: %.1f ns/op, baseline %.1f ns/op\n", name, r->ns_per_op, ns);
+        failed = 1;
+      }
+      if (r->bytes_per_frame > bytes + 0.05) {
+        printf("REGRESSION %s: %.1f bytes/frame, baseline %.1f bytes/frame\n", name, r->bytes_per_frame, bytes);
+        failed = 1;
+      }
+    }
+  }
+  fclose(fp);
+  return failed;
+}
+
+static int
+write_baseline(const char *path)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) {
+    perror(path);
+    return 1;
+  }
+  for (int i = 0; i < result_count; i++) {
+    fprintf(fp, "%s %.1f %.1f\n", results[i].name, results[i].ns_per_op, results[i].bytes_per_frame);
+  }
+  fclose(fp);
+  printf("baseline written to %s\n", path);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *baseline = "baseline.txt";
+  double tolerance = 2.0;
+  int update = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      baseline = argv[++i];
+    } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-u")) {
+      update = 1;
+    } else {
+      fprintf(stderr, "usage: %s [-b baseline] [-t tolerance] [-u]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  memset(&lcd, 0, sizeof(lcd));
+  if (pcd8544_open(&lcd, DRIVER_PCD8544, TRANSPORT_HOST) != ESP_OK) {
+    fprintf(stderr, "cannot open the host transport\n");
+    return 2;
+  }
+
+  for (int round = 0; round < ROUNDS; round++) {
+    seed = 12345;
+    bench_set_pixel();
+    bench_spirograph();
+    bench_line_clipped();
+    bench_fill_screen();
+    bench_fill_rect_bars();
+    bench_fill_circle();
+    bench_fill_triangle();
+    bench_text_page(1, "text_page");
+    bench_text_page(2, "text_page_size2");
+    bench_text_font(&font_5x7, "text_page_5x7");
+    bench_text_font(&font_4x6, "text_page_4x6");
+    bench_image();
+    bench_dither();
+    bench_sprites();
+    bench_canvas();
+    bench_scroll();
+    bench_flush();
+    bench_bus();
+  }
+  pcd8544_close(&lcd);
+
+  for (int i = 0; i < result_count; i++) {
+    printf("%-20s %12.1f ns/op %10.1f bytes/frame\n", results[i].name, results[i].ns_per_op, results[i].bytes_per_frame);
+  }
+
+  if (update) {
+    return write_baseline(baseline);
+  }
+  return compare_baseline(baseline, tolerance);
+}
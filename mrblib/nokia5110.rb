@@ -1,12 +1,7 @@
 module LCD
   class NOKIA5110
-    attr_accessor :color
-    attr_accessor :fontsize
-
     include Constants
     def initialize(options={})
-      @color = options[:color] || LCD::WHITE
-      @fontsize = options[:fontsize] || 1
       @cs = options[:cs] || CS
       @dc = options[:dc] || DC
       @rst = options[:rst] || RST
@@ -16,8 +11,27 @@ module LCD
       @freq = options[:freq] || SPI_FREQ
       @spi_mode = options[:spi_mode] || SPI_MODE
       @dma_ch = options[:dma_ch] || DMA
+      @transport = options[:transport] || TRANSPORT
+      @bus = options[:bus]
+      @driver = options[:driver] || DRIVER_PCD8544
       
-      _init(@cs, @dc, @rst, @mosi, @sck, @miso, @freq, @spi_mode, @dma_ch)
+      _init(@cs, @dc, @rst, @mosi, @sck, @miso, @freq, @spi_mode, @dma_ch, @transport, @bus, @driver)
+      self.flush_mode = options[:flush_mode] || FLUSH_FULL
+      self.color = options[:color] || LCD::WHITE
+      self.fontsize = options[:fontsize] || 1
+    end
+  end
+
+  class Bus
+    include NOKIA5110::Constants
+    def initialize(options={})
+      @mosi = options[:mosi] || MOSI
+      @sck = options[:sck] || SCK
+      @miso = options[:miso] || MISO
+      @dma_ch = options[:dma_ch] || DMA
+      @transport = options[:transport] || TRANSPORT
+
+      _init(@mosi, @sck, @miso, @dma_ch, @transport)
     end
   end
 end
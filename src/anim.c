@@ -0,0 +1,189 @@
+// Delta frame animations.
+// A keyframe and XOR delta frames, each an RLE image. The delta of a frame
+// is zero where nothing moved, so it compresses to a few runs, and the
+// decoder skips the zero runs and reports the banks it changed. The player
+// sends only those banks and keeps a fixed frame rate by dropping the
+// frames it cannot show in time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#include "anim.h"
+
+static uint16_t
+read_le16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+// Check the header and the frames, returns ESP_ERR_INVALID_ARG if the data
+// is not an animation or a frame doesn't match its size.
+esp_err_t
+anim_open(anim_t *anim, const uint8_t *data, int32_t length)
+{
+  if ((length < ANIM_HEADER_SIZE) || (data[0] != ANIM_MAGIC) || (data[1] == 0) || (data[2] == 0)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  anim->data = data;
+  anim->length = length;
+  anim->width = data[1];
+  anim->height = data[2];
+  anim->frames = read_le16(data + 3);
+  if (anim->frames == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  int32_t offset = ANIM_HEADER_SIZE;
+  for (uint16_t i = 0; i < anim->frames; i++) {
+    int16_t w, h;
+    if (offset + ANIM_FRAME_HEADER > length) return ESP_ERR_INVALID_ARG;
+    int32_t len = read_le16(data + offset);
+    offset += ANIM_FRAME_HEADER;
+    if ((offset + len > length) ||
+        (rle_size(data + offset, len, &w, &h) != ESP_OK) || (w != anim->width) || (h != anim->height)) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    offset += len;
+  }
+  if (offset != length) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  anim_rewind(anim);
+  return ESP_OK;
+}
+
+void
+anim_rewind(anim_t *anim)
+{
+  anim->frame = 0;
+  anim->offset = ANIM_HEADER_SIZE;
+}
+
+esp_err_t
+anim_next(anim_t *anim, const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t *banks)
+{
+  if (anim->frame >= anim->frames) {
+    anim_rewind(anim);
+  }
+  const uint8_t *frame = anim->data + anim->offset;
+  int32_t len = read_le16(frame);
+  rle_decoder_t dec;
+  int16_t w, h;
+
+  // the frame must still be the one anim_open checked
+  if ((anim->offset + ANIM_FRAME_HEADER + len > anim->length) ||
+      (rle_size(frame + ANIM_FRAME_HEADER, len, &w, &h) != ESP_OK) || (w != anim->width) || (h != anim->height)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  rle_begin(&dec, tg, x, y, (anim->frame == 0) ? BLIT_COPY : BLIT_XOR);
+  esp_err_t err = rle_feed(&dec, frame + ANIM_FRAME_HEADER, len);
+  if ((err == ESP_OK) && !rle_done(&dec)) {
+    err = ESP_ERR_INVALID_SIZE;
+  }
+  *banks = dec.banks;
+  anim->offset += ANIM_FRAME_HEADER + len;
+  anim->frame++;
+  return err;
+}
+
+// Sleep until the time [us], or return if it is less than a tick away
+static void
+anim_sleep_until(int64_t deadline)
+{
+  int64_t wait = deadline - esp_timer_get_time();
+
+  if (wait <= 0) return;
+#ifdef ESP_PLATFORM
+  TickType_t ticks = (wait / 1000) / portTICK_PERIOD_MS;
+  if (ticks > 0) {
+    vTaskDelay(ticks);
+  }
+#else
+  struct timespec ts = { wait / 1000000, (wait % 1000000) * 1000 };
+  nanosleep(&ts, NULL);
+#endif
+}
+
+esp_err_t
+anim_play(spi_config_t *spicfg, anim_t *anim, int16_t x, int16_t y, uint16_t fps, uint16_t loops, anim_stats_t *stats)
+{
+  int64_t period = (fps > 0) ? (1000000 / fps) : 0;
+  int64_t deadline = esp_timer_get_time();
+  uint32_t count = (uint32_t)anim->frames * loops;
+  uint32_t bytes = spicfg->stats.bytes;
+  uint8_t pending = 0;
+
+  memset(stats, 0, sizeof(anim_stats_t));
+  anim_rewind(anim);
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t banks;
+    esp_err_t err = anim_next(anim, &spicfg->draw.tinygrafx, x, y, &banks);
+    if (err != ESP_OK) {
+      return err;
+    }
+    stats->frames++;
+    pending |= banks;
+
+    // the frame is due before the next deadline, the last one is always shown
+    deadline += period;
+    if ((period > 0) && (i + 1 < count) && (esp_timer_get_time() > deadline)) {
+      stats->dropped++;
+      continue;
+    }
+    if (pending != 0) {
+      pcd8544_send_banks(spicfg, pending);
+      pending = 0;
+    }
+    stats->shown++;
+    anim_sleep_until(deadline);
+  }
+  pcd8544_wait(spicfg);
+  stats->bytes = spicfg->stats.bytes - bytes;
+  return ESP_OK;
+}
+
+int32_t
+anim_encode_header(uint8_t *out, int32_t size, int16_t width, int16_t height, uint16_t frames)
+{
+  if ((size < ANIM_HEADER_SIZE) || (width <= 0) || (width > 255) || (height <= 0) || (height > 255)) {
+    return -1;
+  }
+  out[0] = ANIM_MAGIC;
+  out[1] = width;
+  out[2] = height;
+  out[3] = frames & 0xFF;
+  out[4] = frames >> 8;
+  return ANIM_HEADER_SIZE;
+}
+
+int32_t
+anim_encode_frame(const uint8_t *prev, const uint8_t *frame, int16_t width, int16_t height, uint8_t *out, int32_t size)
+{
+  int32_t total = (int32_t)width * ((height + 7) / 8);
+  const uint8_t *image = frame;
+  uint8_t *delta = NULL;
+
+  if (size < ANIM_FRAME_HEADER) return -1;
+  if (prev != NULL) {
+    delta = (uint8_t *)malloc(total);
+    if (delta == NULL) return -1;
+    for (int32_t i = 0; i < total; i++) {
+      delta[i] = prev[i] ^ frame[i];
+    }
+    image = delta;
+  }
+  int32_t len = rle_encode(image, width, height, out + ANIM_FRAME_HEADER, size - ANIM_FRAME_HEADER);
+  free(delta);
+  if ((len < 0) || (len > UINT16_MAX)) return -1;
+
+  out[0] = len & 0xFF;
+  out[1] = len >> 8;
+  return ANIM_FRAME_HEADER + len;
+}
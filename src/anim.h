@@ -0,0 +1,59 @@
+#ifndef ANIMH_
+#define ANIMH_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pcd8544.h"
+#include "rle.h"
+
+// Animation of RLE frames, see rle.h.
+//
+//   'A', width, height, frame count (16 bit LE),
+//   frame length (16 bit LE), RLE image, ...
+//
+// The first frame is a keyframe drawn with BLIT_COPY, the next frames are
+// XOR deltas to the frame before them. After the last frame the animation
+// starts over with the keyframe.
+#define ANIM_MAGIC          'A'
+#define ANIM_HEADER_SIZE    5
+#define ANIM_FRAME_HEADER   2
+
+typedef struct anim_t {
+  const uint8_t *data;
+  int32_t length;
+  int16_t width;
+  int16_t height;
+  uint16_t frames;          // frame count
+  uint16_t frame;           // next frame to draw
+  int32_t offset;           // next frame in data
+} anim_t;
+
+// Playback counters
+typedef struct anim_stats_t {
+  uint32_t frames;          // frames drawn
+  uint32_t shown;           // frames sent to the display
+  uint32_t dropped;         // frames drawn too late to be shown
+  uint32_t bytes;           // bytes sent to the display
+} anim_stats_t;
+
+esp_err_t anim_open(anim_t *anim, const uint8_t *data, int32_t length);
+void anim_rewind(anim_t *anim);
+
+// Draw the next frame into the frame buffer, *banks is set to the banks it
+// changed
+esp_err_t anim_next(anim_t *anim, const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t *banks);
+
+// Play the animation "loops" times at "fps" frames per second (0 for as
+// fast as possible), sending only the changed banks. A frame that is late
+// by a frame period is not sent, its banks are sent with the next frame.
+esp_err_t anim_play(spi_config_t *spicfg, anim_t *anim, int16_t x, int16_t y, uint16_t fps, uint16_t loops, anim_stats_t *stats);
+
+// Encoding: the header, then each frame, the keyframe with prev NULL.
+// Return the bytes written or -1 if they don't fit in "size" bytes.
+int32_t anim_encode_header(uint8_t *out, int32_t size, int16_t width, int16_t height, uint16_t frames);
+int32_t anim_encode_frame(const uint8_t *prev, const uint8_t *frame, int16_t width, int16_t height, uint8_t *out, int32_t size);
+
+// Largest encoded size of a frame
+#define ANIM_FRAME_MAX(width, height) (ANIM_FRAME_HEADER + RLE_ENCODED_MAX(width, height))
+
+#endif /* ANIMH_ */
@@ -0,0 +1,114 @@
+// Off-screen canvases.
+// The frame buffers of the canvases come from a static pool of fixed size
+// blocks, so creating and dropping canvases doesn't allocate from the heap.
+// A frame buffer that doesn't fit in the pool is allocated with malloc.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "canvas.h"
+
+static const char *TAG = "CANVAS";
+
+static uint8_t pool[CANVAS_POOL_SIZE] __attribute__((aligned(4)));
+static bool pool_used[CANVAS_POOL_BLOCKS];
+static uint32_t pool_fallbacks;
+
+// First fit run of free blocks, returns NULL if there is none
+static uint8_t *
+pool_alloc(int32_t size)
+{
+  int16_t blocks = (size + CANVAS_POOL_BLOCK - 1) / CANVAS_POOL_BLOCK;
+  int16_t run = 0;
+
+  for (int16_t i = 0; i < CANVAS_POOL_BLOCKS; i++) {
+    run = pool_used[i] ? 0 : (run + 1);
+    if (run == blocks) {
+      int16_t start = i - blocks + 1;
+      memset(&pool_used[start], true, blocks);
+      return pool + start * CANVAS_POOL_BLOCK;
+    }
+  }
+  return NULL;
+}
+
+static void
+pool_free(uint8_t *data, int32_t size)
+{
+  int16_t blocks = (size + CANVAS_POOL_BLOCK - 1) / CANVAS_POOL_BLOCK;
+  int16_t start = (data - pool) / CANVAS_POOL_BLOCK;
+
+  memset(&pool_used[start], false, blocks);
+}
+
+// Allocate a cleared canvas of width x height pixels
+esp_err_t
+canvas_open(canvas_t *canvas, int16_t width, int16_t height)
+{
+  if ((width <= 0) || (width > TINYGRAFX_MAX_WIDTH) || (height <= 0)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  int32_t size = (int32_t)width * ((height + 7) / 8);
+  if (size > UINT16_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  tinygrafx_t tg = {
+    .display_width = width,
+    .display_height = height,
+    .display_pixel = size,
+    .font_width = PCD8544_FONT_WIDTH,
+    .font_height = PCD8544_FONT_HEIGHT
+  };
+  tg.display_buffer = pool_alloc(size);
+  canvas->pooled = (tg.display_buffer != NULL);
+  if (!canvas->pooled) {
+    tg.display_buffer = (uint8_t *)malloc(size);
+    if (tg.display_buffer == NULL) {
+      return ESP_ERR_NO_MEM;
+    }
+    pool_fallbacks++;
+    ESP_LOGI(TAG, "canvas_open: pool is full, %d bytes allocated", (int)size);
+  }
+  reset_clip(&tg);
+  buffer_clear(&tg);
+
+  canvas->draw.tinygrafx = tg;
+  canvas->draw.color = WHITE;
+  canvas->draw.fontsize = 1;
+  canvas->draw.font = NULL;
+  canvas->draw.draw_calls = canvas->draw_calls;
+  memset(canvas->draw_calls, 0, sizeof(canvas->draw_calls));
+  return ESP_OK;
+}
+
+// Return the frame buffer to the pool
+void
+canvas_close(canvas_t *canvas)
+{
+  tinygrafx_t *tg = &canvas->draw.tinygrafx;
+
+  if (tg->display_buffer == NULL) return;
+  if (canvas->pooled) {
+    pool_free(tg->display_buffer, tg->display_pixel);
+  } else {
+    free(tg->display_buffer);
+  }
+  tg->display_buffer = NULL;
+}
+
+void
+canvas_pool_stats(canvas_pool_stats_t *stats)
+{
+  int16_t run = 0;
+
+  stats->free = 0;
+  stats->largest = 0;
+  for (int16_t i = 0; i < CANVAS_POOL_BLOCKS; i++) {
+    run = pool_used[i] ? 0 : (run + 1);
+    if (!pool_used[i]) stats->free += CANVAS_POOL_BLOCK;
+    if (run * CANVAS_POOL_BLOCK > stats->largest) stats->largest = run * CANVAS_POOL_BLOCK;
+  }
+  stats->fallbacks = pool_fallbacks;
+}
@@ -0,0 +1,31 @@
+#ifndef CANVASH_
+#define CANVASH_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pcd8544.h"
+
+// Canvas storage pool, allocated in blocks
+#define CANVAS_POOL_SIZE    4096
+#define CANVAS_POOL_BLOCK   32
+#define CANVAS_POOL_BLOCKS  (CANVAS_POOL_SIZE / CANVAS_POOL_BLOCK)
+
+// Off-screen frame buffer in the page layout of the display
+typedef struct canvas_t {
+  draw_state_t draw;        // Frame buffer and drawing state
+  uint32_t draw_calls[STAT_DRAW_MAX];
+  bool pooled;              // the frame buffer is in the pool
+} canvas_t;
+
+// Free bytes of the pool
+typedef struct canvas_pool_stats_t {
+  int32_t free;             // free bytes
+  int32_t largest;          // largest free run [bytes]
+  uint32_t fallbacks;       // frame buffers allocated outside the pool
+} canvas_pool_stats_t;
+
+esp_err_t canvas_open(canvas_t *canvas, int16_t width, int16_t height);
+void canvas_close(canvas_t *canvas);
+void canvas_pool_stats(canvas_pool_stats_t *stats);
+
+#endif /* CANVASH_ */
@@ -0,0 +1,143 @@
+// Text console.
+// A grid of 8x8 character cells on the frame buffer, e.g. 10x6 cells on the
+// PCD8544. Writing a character only updates the grid; rendering draws the
+// cells whose character changed and returns the banks it touched, so the
+// flush can skip the others. A line feed on the last row scrolls the frame
+// buffer up by a bank along with the grid, the text is not drawn again.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "console.h"
+
+// The console draws in display coordinates on the whole frame buffer
+static tinygrafx_t
+console_target(const tinygrafx_t *tg)
+{
+  tinygrafx_t target = *tg;
+
+  set_origin(&target, 0, 0);
+  reset_clip(&target);
+  return target;
+}
+
+void
+console_open(console_t *con, const tinygrafx_t *tg)
+{
+  con->cols = tg->display_width / CONSOLE_CELL;
+  con->rows = tg->display_height / CONSOLE_CELL;
+  if (con->cols > CONSOLE_COLS_MAX) con->cols = CONSOLE_COLS_MAX;
+  if (con->rows > CONSOLE_ROWS_MAX) con->rows = CONSOLE_ROWS_MAX;
+  con->col = 0;
+  con->row = 0;
+  con->banks = 0;
+
+  // draw every cell once, this clears the grid area
+  memset(con->cells, ' ', sizeof(con->cells));
+  for (int16_t r = 0; r < con->rows; r++) {
+    con->dirty[r] = (1 << con->cols) - 1;
+  }
+}
+
+// Blank the grid and home the cursor
+void
+console_clear(console_t *con)
+{
+  for (int16_t r = 0; r < con->rows; r++) {
+    for (int16_t c = 0; c < con->cols; c++) {
+      if (con->cells[r][c] != ' ') {
+        con->cells[r][c] = ' ';
+        con->dirty[r] |= 1 << c;
+      }
+    }
+  }
+  con->col = 0;
+  con->row = 0;
+}
+
+void
+console_locate(console_t *con, int16_t col, int16_t row)
+{
+  con->col = (col < 0) ? 0 : ((col >= con->cols) ? (con->cols - 1) : col);
+  con->row = (row < 0) ? 0 : ((row >= con->rows) ? (con->rows - 1) : row);
+}
+
+// Move the cursor to the next line, scroll up on the last line.
+// The frame buffer moves with the grid, so the drawn cells stay valid.
+static void
+console_newline(console_t *con, const tinygrafx_t *tg)
+{
+  con->col = 0;
+  if (con->row + 1 < con->rows) {
+    con->row++;
+    return;
+  }
+
+  memmove(con->cells[0], con->cells[1], (con->rows - 1) * CONSOLE_COLS_MAX);
+  memmove(con->dirty, con->dirty + 1, (con->rows - 1) * sizeof(con->dirty[0]));
+  memset(con->cells[con->rows - 1], ' ', CONSOLE_COLS_MAX);
+  con->dirty[con->rows - 1] = 0;
+
+  scroll_region(tg, 0, 0, con->cols * CONSOLE_CELL, con->rows * CONSOLE_CELL, 0, -CONSOLE_CELL, BLACK);
+  con->banks |= (1 << con->rows) - 1;
+}
+
+// Write the text at the cursor. Handles \n, \r, \b and \f (clear).
+void
+console_write(console_t *con, const tinygrafx_t *tg, const uint8_t *text, int16_t len)
+{
+  tinygrafx_t target = console_target(tg);
+
+  for (int16_t i = 0; i < len; i++) {
+    uint8_t c = text[i];
+
+    switch (c) {
+      case '\n':
+        console_newline(con, &target);
+        continue;
+      case '\r':
+        con->col = 0;
+        continue;
+      case '\b':
+        if (con->col > 0) con->col--;
+        continue;
+      case '\f':
+        console_clear(con);
+        continue;
+    }
+    if (c < ' ') continue;
+
+    if (con->col >= con->cols) {
+      console_newline(con, &target);
+    }
+    if (con->cells[con->row][con->col] != c) {
+      con->cells[con->row][con->col] = c;
+      con->dirty[con->row] |= 1 << con->col;
+    }
+    con->col++;
+  }
+}
+
+// Draw the changed cells, white on black.
+// Returns the banks changed since the last render.
+uint8_t
+console_render(console_t *con, const tinygrafx_t *tg)
+{
+  uint8_t banks = con->banks;
+  tinygrafx_t target = console_target(tg);
+
+  for (int16_t r = 0; r < con->rows; r++) {
+    if (con->dirty[r] == 0) continue;
+
+    for (int16_t c = 0; c < con->cols; c++) {
+      if ((con->dirty[r] & (1 << c)) == 0) continue;
+      draw_fill_rect(&target, c * CONSOLE_CELL, r * CONSOLE_CELL, CONSOLE_CELL, CONSOLE_CELL, BLACK);
+      draw_char(&target, c * CONSOLE_CELL, r * CONSOLE_CELL, con->cells[r][c], WHITE, 1);
+    }
+    con->dirty[r] = 0;
+    banks |= 1 << r;
+  }
+  con->banks = 0;
+  return banks;
+}
@@ -0,0 +1,31 @@
+#ifndef CONSOLEH_
+#define CONSOLEH_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tiny_grafx.h"
+
+// Character cells of the 8x8 font
+#define CONSOLE_CELL        8
+#define CONSOLE_COLS_MAX    (TINYGRAFX_MAX_WIDTH / CONSOLE_CELL)
+#define CONSOLE_ROWS_MAX    8
+
+// Text console on a frame buffer. The cells hold the characters, a cell is
+// drawn again only when its character changed.
+typedef struct console_t {
+  uint8_t cells[CONSOLE_ROWS_MAX][CONSOLE_COLS_MAX];
+  uint16_t dirty[CONSOLE_ROWS_MAX];   // cells to draw, a bit per column
+  int16_t cols;             // grid size
+  int16_t rows;
+  int16_t col;              // cursor, col == cols wraps before the next character
+  int16_t row;
+  uint8_t banks;            // banks changed since the last render, a bit per bank
+} console_t;
+
+void console_open(console_t *con, const tinygrafx_t *tg);
+void console_clear(console_t *con);
+void console_write(console_t *con, const tinygrafx_t *tg, const uint8_t *text, int16_t len);
+void console_locate(console_t *con, int16_t col, int16_t row);
+uint8_t console_render(console_t *con, const tinygrafx_t *tg);
+
+#endif /* CONSOLEH_ */
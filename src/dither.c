@@ -0,0 +1,187 @@
+// Grayscale images on the 1bpp frame buffer.
+// The pixels are converted a bank row at a time: 8 rows of the image make
+// one byte per column in the page layout, which is then drawn like a bitmap.
+// A bank row inside the clip rectangle on a bank boundary is converted
+// straight into the frame buffer.
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "dither.h"
+
+// Compare 8 levels at once in a 64-bit word, the bytes of a word are the
+// columns from left to right
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define DITHER_SWAR
+#endif
+
+static const uint8_t bayer8[8][8] = {
+  {  0, 32,  8, 40,  2, 34, 10, 42 },
+  { 48, 16, 56, 24, 50, 18, 58, 26 },
+  { 12, 44,  4, 36, 14, 46,  6, 38 },
+  { 60, 28, 52, 20, 62, 30, 54, 22 },
+  {  3, 35, 11, 43,  1, 33,  9, 41 },
+  { 51, 19, 59, 27, 49, 17, 57, 25 },
+  { 15, 47,  7, 39, 13, 45,  5, 37 },
+  { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+// Threshold of a display pixel, the pixel is set if (level >> 1) >= threshold.
+// Comparing 7-bit levels leaves the top bit of a byte free for the borrow.
+static inline uint8_t
+bayer_threshold(int16_t x, int16_t y)
+{
+  return 2 * bayer8[y & 7][x & 7] + 1;
+}
+
+// Convert "rows" rows of the image at "src" into a bank row at "out".
+// ax, ay is the display position of the first pixel.
+static void
+bayer_bank(uint8_t *out, const uint8_t *src, int16_t w, int16_t rows, int16_t ax, int16_t ay)
+{
+  int16_t c = 0;
+
+#ifdef DITHER_SWAR
+  // 8 columns per step: each row is compared as a word, the compare bits
+  // of the rows are moved into the bits of the column bytes
+  uint64_t thresholds[8];
+  for (int16_t r = 0; r < rows; r++) {
+    uint64_t t = 0;
+    for (int16_t i = 7; i >= 0; i--) {
+      t = (t << 8) | bayer_threshold(ax + i, ay + r);
+    }
+    thresholds[r] = t;
+  }
+  for (; c + 8 <= w; c += 8) {
+    uint64_t bits = 0;
+    for (int16_t r = 0; r < rows; r++) {
+      uint64_t level;
+      memcpy(&level, src + r * w + c, 8);
+      uint64_t ge = (((level >> 1) & 0x7F7F7F7F7F7F7F7FULL) | 0x8080808080808080ULL) - thresholds[r];
+      bits |= ((ge >> 7) & 0x0101010101010101ULL) << r;
+    }
+    memcpy(out + c, &bits, 8);
+  }
+#endif
+  for (; c < w; c++) {
+    uint8_t bits = 0;
+    for (int16_t r = 0; r < rows; r++) {
+      if ((src[r * w + c] >> 1) >= bayer_threshold(ax + c, ay + r)) bits |= 1 << r;
+    }
+    out[c] = bits;
+  }
+}
+
+// Ordered dithering, a bank row at a time
+static void
+bayer_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h)
+{
+  uint8_t out[DITHER_MAX_WIDTH];
+  int16_t ax = x + tg->origin_x;
+  int16_t ay = y + tg->origin_y;
+  bool inside = (ax >= tg->clip_x0) && (ax + w - 1 <= tg->clip_x1);
+
+  for (int16_t row = 0; row < h; row += 8) {
+    int16_t rows = (h - row < 8) ? (h - row) : 8;
+    int16_t top = ay + row;
+
+    if ((top + rows <= tg->clip_y0) || (top > tg->clip_y1)) continue;
+    if (inside && (rows == 8) && ((top & 7) == 0) && (top >= tg->clip_y0) && (top + 7 <= tg->clip_y1)) {
+      bayer_bank(tg->display_buffer + ax + (top / 8) * tg->display_width, gray + row * w, w, 8, ax, top);
+    } else {
+      bayer_bank(out, gray + row * w, w, rows, ax, top);
+      blit(tg, x, y + row, out, NULL, w, rows, BLIT_COPY);
+    }
+  }
+}
+
+// Floyd-Steinberg error diffusion in a serpentine scan.
+// The errors of the current and the next row are kept x16, with a guard
+// column on each side.
+static void
+diffusion_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h)
+{
+  int16_t errors[2][DITHER_MAX_WIDTH + 2];
+  uint8_t out[DITHER_MAX_WIDTH];
+  int16_t *cur = errors[0];
+  int16_t *next = errors[1];
+
+  memset(errors, 0, sizeof(errors));
+  for (int16_t row = 0; row < h; row++) {
+    int16_t r = row & 7;
+    int16_t dir = (row & 1) ? -1 : 1;
+    int16_t c = (dir > 0) ? 0 : (w - 1);
+    const uint8_t *src = gray + row * w;
+
+    if (r == 0) memset(out, 0, w);
+    for (int16_t i = 0; i < w; i++, c += dir) {
+      int16_t level = src[c] + cur[c + 1] / 16;
+      int16_t error = level;
+
+      if (level >= 128) {
+        out[c] |= 1 << r;
+        error = level - 255;
+      }
+      cur[c + 1 + dir] += error * 7;
+      next[c + 1 - dir] += error * 3;
+      next[c + 1] += error * 5;
+      next[c + 1 + dir] += error;
+    }
+    int16_t *t = cur;
+    cur = next;
+    next = t;
+    memset(next, 0, sizeof(errors[0]));
+
+    if ((r == 7) || (row == h - 1)) {
+      blit(tg, x, y + row - r, out, NULL, w, r + 1, BLIT_COPY);
+    }
+  }
+}
+
+void
+dither_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h, int16_t method)
+{
+  if ((w <= 0) || (w > DITHER_MAX_WIDTH) || (h <= 0)) return;
+
+  if (method == DITHER_DIFFUSION) {
+    diffusion_draw(tg, x, y, gray, w, h);
+  } else {
+    bayer_draw(tg, x, y, gray, w, h);
+  }
+}
+
+void
+dither_gray(const tinygrafx_t *planes, int16_t count, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h)
+{
+  uint8_t out[DITHER_PLANES_MAX][DITHER_MAX_WIDTH];
+  int16_t ax = x + planes[0].origin_x;
+  int16_t ay = y + planes[0].origin_y;
+
+  if ((w <= 0) || (w > DITHER_MAX_WIDTH) || (h <= 0)) return;
+  if ((count < 1) || (count > DITHER_PLANES_MAX)) return;
+
+  for (int16_t row = 0; row < h; row += 8) {
+    int16_t rows = (h - row < 8) ? (h - row) : 8;
+
+    memset(out, 0, sizeof(out));
+    for (int16_t r = 0; r < rows; r++) {
+      const uint8_t *src = gray + (row + r) * w;
+      const uint8_t *thresholds = bayer8[(ay + row + r) & 7];
+      uint8_t bit = 1 << r;
+
+      for (int16_t c = 0; c < w; c++) {
+        // step 0 to count, the pixel is shown in the first "step" planes
+        int16_t step = (src[c] * count + thresholds[(ax + c) & 7] * 4 + 2) >> 8;
+        if (step == 0) continue;
+        out[0][c] |= bit;
+        for (int16_t k = step; k < count; k++) {
+          out[k][c] |= bit;
+        }
+      }
+    }
+    for (int16_t k = 0; k < count; k++) {
+      blit(&planes[k], x, y + row, out[k], NULL, w, rows, BLIT_COPY);
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef DITHERH_
+#define DITHERH_
+
+#include <stdint.h>
+#include "tiny_grafx.h"
+
+// Dithering methods
+#define DITHER_BAYER      0   // ordered, 8x8 Bayer matrix
+#define DITHER_DIFFUSION  1   // error diffusion, Floyd-Steinberg
+
+// Widest grayscale image, a bank row of it is converted on the stack
+#define DITHER_MAX_WIDTH  TINYGRAFX_MAX_WIDTH
+
+// Most bit planes of a temporal grayscale image
+#define DITHER_PLANES_MAX 3
+
+// Draw an 8-bit grayscale image of w x h pixels, a byte per pixel row by
+// row, as 1bpp pixels. A level is the share of set pixels: 0 sets none,
+// 255 sets all of them. The Bayer matrix is aligned to the display, so
+// images drawn next to each other continue the pattern.
+void dither_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h, int16_t method);
+
+// Draw a grayscale image as "count" bit planes shown one after the other.
+// The levels are quantized to count + 1 steps with the Bayer matrix, a
+// pixel of step n is set in the first n planes. planes[0] receives the
+// first plane, planes[1..] receive the difference of each plane to the
+// first (XOR overlays).
+void dither_gray(const tinygrafx_t *planes, int16_t count, int16_t x, int16_t y, const uint8_t *gray, int16_t w, int16_t h);
+
+#endif /* DITHERH_ */
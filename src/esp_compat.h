@@ -0,0 +1,47 @@
+#ifndef ESP_COMPAT_H_
+#define ESP_COMPAT_H_
+
+// ESP-IDF definitions used by the portable code (tiny_grafx, PCD8544
+// protocol layer). On the ESP32 these come from esp-idf, on a host build
+// they are replaced by minimal equivalents.
+
+#ifdef ESP_PLATFORM
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#else
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_ERR_TIMEOUT         0x107
+
+#define ESP_LOGI(tag, format, ...) fprintf(stderr, "I (%s) " format "\n", tag, ##__VA_ARGS__)
+
+#define DRAM_ATTR
+
+// microseconds since start, like the esp_timer
+static inline int64_t
+esp_timer_get_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif /* ESP_PLATFORM */
+
+#endif /* ESP_COMPAT_H_ */
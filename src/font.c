@@ -0,0 +1,215 @@
+// Bitmap fonts.
+// The glyphs are stored in the page layout of the frame buffer with their
+// own widths, and looked up by codepoint through a short sorted list of
+// ranges, so sparse codepoints beyond ASCII cost a few bytes. Text is
+// decoded from UTF-8.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+
+// 8x8 monochrome bitmap fonts from font8x8_basic.h by dhepper/font8x8
+// https://github.com/dhepper/font8x8
+// converted to the column-major page layout.
+#include "font8x8_basic_page.h"
+#include "font5x7_page.h"
+#include "font4x6_page.h"
+
+static const font_range_t font8x8_ranges[] = {
+  {0x0000, 0x007F, 0}
+};
+
+const font_t font_8x8 = {
+  .name = "8x8",
+  .height = 8,
+  .line_height = 8,
+  .spacing = 0,
+  .width = 8,
+  .fallback = '?',
+  .range_count = 1,
+  .ranges = font8x8_ranges,
+  .glyphs = NULL,
+  .bitmap = font8x8_basic_page[0]
+};
+
+const font_t font_5x7 = {
+  .name = "5x7",
+  .height = 7,
+  .line_height = 8,
+  .spacing = 1,
+  .fallback = '?',
+  .range_count = sizeof(font5x7_ranges) / sizeof(font5x7_ranges[0]),
+  .ranges = font5x7_ranges,
+  .glyphs = font5x7_glyphs,
+  .bitmap = font5x7_bitmap
+};
+
+const font_t font_4x6 = {
+  .name = "4x6",
+  .height = 6,
+  .line_height = 6,
+  .spacing = 1,
+  .fallback = '?',
+  .range_count = sizeof(font4x6_ranges) / sizeof(font4x6_ranges[0]),
+  .ranges = font4x6_ranges,
+  .glyphs = font4x6_glyphs,
+  .bitmap = font4x6_bitmap
+};
+
+const font_t *const fonts[] = {
+  &font_8x8, &font_5x7, &font_4x6, NULL
+};
+
+const font_t *
+font_find(const char *name)
+{
+  for (int16_t i = 0; fonts[i] != NULL; i++) {
+    if (strcmp(fonts[i]->name, name) == 0) {
+      return fonts[i];
+    }
+  }
+  return NULL;
+}
+
+// An invalid or truncated sequence decodes to FONT_REPLACEMENT,
+// the bytes after its last valid byte are decoded again.
+uint32_t
+utf8_next(const uint8_t **text, const uint8_t *end)
+{
+  const uint8_t *p = *text;
+  uint8_t c = *p++;
+  uint32_t cp, min;
+  int16_t more;
+
+  if (c < 0x80) {
+    *text = p;
+    return c;
+  } else if ((c & 0xE0) == 0xC0) {
+    cp = c & 0x1F;
+    more = 1;
+    min = 0x80;
+  } else if ((c & 0xF0) == 0xE0) {
+    cp = c & 0x0F;
+    more = 2;
+    min = 0x800;
+  } else if ((c & 0xF8) == 0xF0) {
+    cp = c & 0x07;
+    more = 3;
+    min = 0x10000;
+  } else {
+    *text = p;
+    return FONT_REPLACEMENT;
+  }
+
+  for (; more > 0; more--) {
+    if ((p >= end) || ((*p & 0xC0) != 0x80)) {
+      *text = p;
+      return FONT_REPLACEMENT;
+    }
+    cp = (cp << 6) | (*p++ & 0x3F);
+  }
+  *text = p;
+  if ((cp < min) || (cp > 0x10FFFF) || ((cp >= 0xD800) && (cp <= 0xDFFF))) {
+    return FONT_REPLACEMENT;
+  }
+  return cp;
+}
+
+bool
+font_glyph(const font_t *font, uint32_t codepoint, const uint8_t **bitmap, int16_t *width)
+{
+  int16_t lo = 0, hi = font->range_count - 1;
+
+  while (lo <= hi) {
+    int16_t mid = (lo + hi) / 2;
+    const font_range_t *range = &font->ranges[mid];
+
+    if (codepoint < range->first) {
+      hi = mid - 1;
+    } else if (codepoint > range->last) {
+      lo = mid + 1;
+    } else {
+      uint16_t index = range->glyph + (codepoint - range->first);
+      if (font->glyphs == NULL) {
+        *width = font->width;
+        *bitmap = font->bitmap + index * font->width * ((font->height + 7) / 8);
+      } else {
+        *width = font->glyphs[index].width;
+        *bitmap = font->bitmap + font->glyphs[index].offset;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+font_draw_glyph(const font_t *font, uint32_t codepoint, const uint8_t **bitmap, int16_t *width)
+{
+  if (font_glyph(font, codepoint, bitmap, width)) {
+    return true;
+  }
+  if (codepoint < ' ') {
+    return false;
+  }
+  return font_glyph(font, font->fallback, bitmap, width);
+}
+
+int16_t
+font_draw_text(const tinygrafx_t *tg, const font_t *font, int16_t x, int16_t y, const uint8_t *text, int16_t length, int16_t color)
+{
+  const uint8_t *end = text + length;
+  int16_t x0 = x;
+  int16_t rop;
+
+  switch (color) {
+    case WHITE: rop = BLIT_OR; break;
+    case BLACK: rop = BLIT_ERASE; break;
+    case INVERT:rop = BLIT_XOR; break;
+    default: return x;
+  }
+
+  while (text < end) {
+    uint32_t codepoint = utf8_next(&text, end);
+    const uint8_t *bitmap;
+    int16_t width;
+
+    if (codepoint == '\n') {
+      x = x0;
+      y += font->line_height;
+      continue;
+    }
+    if (!font_draw_glyph(font, codepoint, &bitmap, &width)) continue;
+
+    blit(tg, x, y, bitmap, NULL, width, font->height, rop);
+    x += width + font->spacing;
+  }
+  return x;
+}
+
+int16_t
+font_text_width(const font_t *font, const uint8_t *text, int16_t length)
+{
+  const uint8_t *end = text + length;
+  int16_t line = 0, widest = 0;
+
+  while (text < end) {
+    uint32_t codepoint = utf8_next(&text, end);
+    const uint8_t *bitmap;
+    int16_t width;
+
+    if (codepoint == '\n') {
+      line = 0;
+      continue;
+    }
+    if (!font_draw_glyph(font, codepoint, &bitmap, &width)) continue;
+
+    // the spacing after the last glyph is not part of the text
+    if (line > 0) line += font->spacing;
+    line += width;
+    if (line > widest) widest = line;
+  }
+  return widest;
+}
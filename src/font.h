@@ -0,0 +1,66 @@
+#ifndef FONTH_
+#define FONTH_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tiny_grafx.h"
+
+// Codepoint of an invalid UTF-8 sequence
+#define FONT_REPLACEMENT    0xFFFD
+
+// Glyph of a proportional font
+typedef struct font_glyph_t {
+  uint16_t offset;          // first byte of the glyph in the bitmap
+  uint8_t width;            // columns
+} font_glyph_t;
+
+// Codepoints first..last are the consecutive glyphs from "glyph" on
+typedef struct font_range_t {
+  uint16_t first;
+  uint16_t last;
+  uint16_t glyph;
+} font_range_t;
+
+// Bitmap font in the page layout of the frame buffer.
+// A glyph is width bytes per bank, (height + 7) / 8 banks, so drawing it is a
+// blit of a byte per column. The ranges are sorted by codepoint.
+typedef struct font_t {
+  const char *name;
+  uint8_t height;           // pixel rows of a glyph
+  uint8_t line_height;      // rows from a line of text to the next
+  uint8_t spacing;          // blank columns after a glyph
+  uint8_t width;            // columns of every glyph if glyphs is NULL
+  uint16_t fallback;        // codepoint drawn for a missing glyph
+  uint16_t range_count;
+  const font_range_t *ranges;
+  const font_glyph_t *glyphs;   // NULL for a fixed width font
+  const uint8_t *bitmap;
+} font_t;
+
+extern const font_t font_8x8;
+extern const font_t font_5x7;
+extern const font_t font_4x6;
+
+// Font by name ("8x8", "5x7", "4x6"), NULL if there is none.
+// fonts[] lists them, terminated by NULL.
+extern const font_t *const fonts[];
+const font_t *font_find(const char *name);
+
+// Decode the UTF-8 sequence at *text and move past it
+uint32_t utf8_next(const uint8_t **text, const uint8_t *end);
+
+// Glyph of the codepoint, false if the font doesn't have it
+bool font_glyph(const font_t *font, uint32_t codepoint, const uint8_t **bitmap, int16_t *width);
+
+// Glyph to draw for the codepoint, the fallback if the font doesn't have it.
+// False to skip it, for control characters missing in the font.
+bool font_draw_glyph(const font_t *font, uint32_t codepoint, const uint8_t **bitmap, int16_t *width);
+
+// Draw UTF-8 text, a line feed starts a new line at x.
+// Returns the x coordinate after the last glyph.
+int16_t font_draw_text(const tinygrafx_t *tg, const font_t *font, int16_t x, int16_t y, const uint8_t *text, int16_t length, int16_t color);
+
+// Width in pixels of the widest line of the text
+int16_t font_text_width(const font_t *font, const uint8_t *text, int16_t length);
+
+#endif /* FONTH_ */
@@ -0,0 +1,231 @@
+/**
+ * 4x6 proportional font, in column-major page layout.
+ *
+ * 3x5 glyphs with a descender row, most glyphs are 3 columns wide plus a
+ * blank column: 21 characters on a line of 84 pixels and 8 lines on 48.
+ *
+ * License: Public Domain
+ **/
+
+// Constants: font4x6_bitmap, font4x6_glyphs, font4x6_ranges
+// Each byte is a column of the glyph, the LSB is the top pixel. This is the
+// same layout as a bank of the frame buffer, so a glyph is a byte per column.
+// Covers U+0020 - U+007E, the degree, plus-minus and micro signs and the
+// arrows U+2190 - U+2193.
+
+static const uint8_t font4x6_bitmap[] = {
+    0x00, 0x00,                   // U+0020 ( )
+    0x17,                         // U+0021 (!)
+    0x03, 0x00, 0x03,             // U+0022 (")
+    0x1F, 0x0A, 0x1F,             // U+0023 (#)
+    0x0A, 0x1F, 0x05,             // U+0024 ($)
+    0x09, 0x04, 0x12,             // U+0025 (%)
+    0x0F, 0x17, 0x1C,             // U+0026 (&)
+    0x03,                         // U+0027 (')
+    0x0E, 0x11,                   // U+0028 (()
+    0x11, 0x0E,                   // U+0029 ())
+    0x05, 0x02, 0x05,             // U+002A (*)
+    0x04, 0x0E, 0x04,             // U+002B (+)
+    0x10, 0x08,                   // U+002C (,)
+    0x04, 0x04, 0x04,             // U+002D (-)
+    0x10,                         // U+002E (.)
+    0x18, 0x04, 0x03,             // U+002F (/)
+    0x1E, 0x11, 0x0F,             // U+0030 (0)
+    0x02, 0x1F,                   // U+0031 (1)
+    0x19, 0x15, 0x12,             // U+0032 (2)
+    0x11, 0x15, 0x0A,             // U+0033 (3)
+    0x07, 0x04, 0x1F,             // U+0034 (4)
+    0x17, 0x15, 0x09,             // U+0035 (5)
+    0x1E, 0x15, 0x1D,             // U+0036 (6)
+    0x19, 0x05, 0x03,             // U+0037 (7)
+    0x1F, 0x15, 0x1F,             // U+0038 (8)
+    0x17, 0x15, 0x0F,             // U+0039 (9)
+    0x0A,                         // U+003A (:)
+    0x10, 0x0A,                   // U+003B (;)
+    0x04, 0x0A, 0x11,             // U+003C (<)
+    0x0A, 0x0A, 0x0A,             // U+003D (=)
+    0x11, 0x0A, 0x04,             // U+003E (>)
+    0x01, 0x15, 0x02,             // U+003F (?)
+    0x0E, 0x15, 0x16,             // U+0040 (@)
+    0x1E, 0x05, 0x1E,             // U+0041 (A)
+    0x1F, 0x15, 0x0A,             // U+0042 (B)
+    0x0E, 0x11, 0x11,             // U+0043 (C)
+    0x1F, 0x11, 0x0E,             // U+0044 (D)
+    0x1F, 0x15, 0x15,             // U+0045 (E)
+    0x1F, 0x05, 0x05,             // U+0046 (F)
+    0x0E, 0x15, 0x1D,             // U+0047 (G)
+    0x1F, 0x04, 0x1F,             // U+0048 (H)
+    0x11, 0x1F, 0x11,             // U+0049 (I)
+    0x08, 0x10, 0x0F,             // U+004A (J)
+    0x1F, 0x04, 0x1B,             // U+004B (K)
+    0x1F, 0x10, 0x10,             // U+004C (L)
+    0x1F, 0x06, 0x1F,             // U+004D (M)
+    0x1F, 0x0E, 0x1F,             // U+004E (N)
+    0x0E, 0x11, 0x0E,             // U+004F (O)
+    0x1F, 0x05, 0x02,             // U+0050 (P)
+    0x0E, 0x19, 0x1E,             // U+0051 (Q)
+    0x1F, 0x0D, 0x16,             // U+0052 (R)
+    0x12, 0x15, 0x09,             // U+0053 (S)
+    0x01, 0x1F, 0x01,             // U+0054 (T)
+    0x0F, 0x10, 0x1F,             // U+0055 (U)
+    0x07, 0x18, 0x07,             // U+0056 (V)
+    0x1F, 0x0C, 0x1F,             // U+0057 (W)
+    0x1B, 0x04, 0x1B,             // U+0058 (X)
+    0x03, 0x1C, 0x03,             // U+0059 (Y)
+    0x19, 0x15, 0x13,             // U+005A (Z)
+    0x1F, 0x11, 0x11,             // U+005B ([)
+    0x03, 0x04, 0x18,             // U+005C (\)
+    0x11, 0x11, 0x1F,             // U+005D (])
+    0x02, 0x01, 0x02,             // U+005E (^)
+    0x10, 0x10, 0x10,             // U+005F (_)
+    0x01, 0x02,                   // U+0060 (`)
+    0x1A, 0x16, 0x1C,             // U+0061 (a)
+    0x1F, 0x12, 0x0C,             // U+0062 (b)
+    0x0C, 0x12, 0x12,             // U+0063 (c)
+    0x0C, 0x12, 0x1F,             // U+0064 (d)
+    0x0C, 0x1A, 0x16,             // U+0065 (e)
+    0x04, 0x1E, 0x05,             // U+0066 (f)
+    0x0C, 0x2A, 0x1E,             // U+0067 (g)
+    0x1F, 0x02, 0x1C,             // U+0068 (h)
+    0x1D,                         // U+0069 (i)
+    0x10, 0x20, 0x1D,             // U+006A (j)
+    0x1F, 0x0C, 0x12,             // U+006B (k)
+    0x11, 0x1F, 0x10,             // U+006C (l)
+    0x1E, 0x06, 0x1C,             // U+006D (m)
+    0x1E, 0x02, 0x1C,             // U+006E (n)
+    0x0C, 0x12, 0x0C,             // U+006F (o)
+    0x3E, 0x12, 0x0C,             // U+0070 (p)
+    0x0C, 0x12, 0x3E,             // U+0071 (q)
+    0x1C, 0x02, 0x02,             // U+0072 (r)
+    0x14, 0x1E, 0x0A,             // U+0073 (s)
+    0x02, 0x1F, 0x12,             // U+0074 (t)
+    0x0E, 0x10, 0x1E,             // U+0075 (u)
+    0x0E, 0x18, 0x0E,             // U+0076 (v)
+    0x1E, 0x08, 0x1E,             // U+0077 (w)
+    0x12, 0x0C, 0x12,             // U+0078 (x)
+    0x06, 0x28, 0x1E,             // U+0079 (y)
+    0x1A, 0x1E, 0x16,             // U+007A (z)
+    0x04, 0x1F, 0x11,             // U+007B ({)
+    0x1F,                         // U+007C (|)
+    0x11, 0x1F, 0x04,             // U+007D (})
+    0x02, 0x03, 0x01,             // U+007E (~)
+    0x02, 0x05, 0x02,             // U+00B0 (°)
+    0x12, 0x17, 0x12,             // U+00B1 (±)
+    0x3E, 0x10, 0x0E,             // U+00B5 (µ)
+    0x04, 0x0E, 0x04, 0x04,       // U+2190 (←)
+    0x02, 0x1F, 0x02,             // U+2191 (↑)
+    0x04, 0x04, 0x0E, 0x04,       // U+2192 (→)
+    0x08, 0x1F, 0x08              // U+2193 (↓)
+};
+
+static const font_glyph_t font4x6_glyphs[] = {
+    {   0, 2},      // U+0020 ( )
+    {   2, 1},      // U+0021 (!)
+    {   3, 3},      // U+0022 (")
+    {   6, 3},      // U+0023 (#)
+    {   9, 3},      // U+0024 ($)
+    {  12, 3},      // U+0025 (%)
+    {  15, 3},      // U+0026 (&)
+    {  18, 1},      // U+0027 (')
+    {  19, 2},      // U+0028 (()
+    {  21, 2},      // U+0029 ())
+    {  23, 3},      // U+002A (*)
+    {  26, 3},      // U+002B (+)
+    {  29, 2},      // U+002C (,)
+    {  31, 3},      // U+002D (-)
+    {  34, 1},      // U+002E (.)
+    {  35, 3},      // U+002F (/)
+    {  38, 3},      // U+0030 (0)
+    {  41, 2},      // U+0031 (1)
+    {  43, 3},      // U+0032 (2)
+    {  46, 3},      // U+0033 (3)
+    {  49, 3},      // U+0034 (4)
+    {  52, 3},      // U+0035 (5)
+    {  55, 3},      // U+0036 (6)
+    {  58, 3},      // U+0037 (7)
+    {  61, 3},      // U+0038 (8)
+    {  64, 3},      // U+0039 (9)
+    {  67, 1},      // U+003A (:)
+    {  68, 2},      // U+003B (;)
+    {  70, 3},      // U+003C (<)
+    {  73, 3},      // U+003D (=)
+    {  76, 3},      // U+003E (>)
+    {  79, 3},      // U+003F (?)
+    {  82, 3},      // U+0040 (@)
+    {  85, 3},      // U+0041 (A)
+    {  88, 3},      // U+0042 (B)
+    {  91, 3},      // U+0043 (C)
+    {  94, 3},      // U+0044 (D)
+    {  97, 3},      // U+0045 (E)
+    { 100, 3},      // U+0046 (F)
+    { 103, 3},      // U+0047 (G)
+    { 106, 3},      // U+0048 (H)
+    { 109, 3},      // U+0049 (I)
+    { 112, 3},      // U+004A (J)
+    { 115, 3},      // U+004B (K)
+    { 118, 3},      // U+004C (L)
+    { 121, 3},      // U+004D (M)
+    { 124, 3},      // U+004E (N)
+    { 127, 3},      // U+004F (O)
+    { 130, 3},      // U+0050 (P)
+    { 133, 3},      // U+0051 (Q)
+    { 136, 3},      // U+0052 (R)
+    { 139, 3},      // U+0053 (S)
+    { 142, 3},      // U+0054 (T)
+    { 145, 3},      // U+0055 (U)
+    { 148, 3},      // U+0056 (V)
+    { 151, 3},      // U+0057 (W)
+    { 154, 3},      // U+0058 (X)
+    { 157, 3},      // U+0059 (Y)
+    { 160, 3},      // U+005A (Z)
+    { 163, 3},      // U+005B ([)
+    { 166, 3},      // U+005C (\)
+    { 169, 3},      // U+005D (])
+    { 172, 3},      // U+005E (^)
+    { 175, 3},      // U+005F (_)
+    { 178, 2},      // U+0060 (`)
+    { 180, 3},      // U+0061 (a)
+    { 183, 3},      // U+0062 (b)
+    { 186, 3},      // U+0063 (c)
+    { 189, 3},      // U+0064 (d)
+    { 192, 3},      // U+0065 (e)
+    { 195, 3},      // U+0066 (f)
+    { 198, 3},      // U+0067 (g)
+    { 201, 3},      // U+0068 (h)
+    { 204, 1},      // U+0069 (i)
+    { 205, 3},      // U+006A (j)
+    { 208, 3},      // U+006B (k)
+    { 211, 3},      // U+006C (l)
+    { 214, 3},      // U+006D (m)
+    { 217, 3},      // U+006E (n)
+    { 220, 3},      // U+006F (o)
+    { 223, 3},      // U+0070 (p)
+    { 226, 3},      // U+0071 (q)
+    { 229, 3},      // U+0072 (r)
+    { 232, 3},      // U+0073 (s)
+    { 235, 3},      // U+0074 (t)
+    { 238, 3},      // U+0075 (u)
+    { 241, 3},      // U+0076 (v)
+    { 244, 3},      // U+0077 (w)
+    { 247, 3},      // U+0078 (x)
+    { 250, 3},      // U+0079 (y)
+    { 253, 3},      // U+007A (z)
+    { 256, 3},      // U+007B ({)
+    { 259, 1},      // U+007C (|)
+    { 260, 3},      // U+007D (})
+    { 263, 3},      // U+007E (~)
+    { 266, 3},      // U+00B0 (°)
+    { 269, 3},      // U+00B1 (±)
+    { 272, 3},      // U+00B5 (µ)
+    { 275, 4},      // U+2190 (←)
+    { 279, 3},      // U+2191 (↑)
+    { 282, 4},      // U+2192 (→)
+    { 286, 3}       // U+2193 (↓)
+};
+
+static const font_range_t font4x6_ranges[] = {
+    {0x0020, 0x007E,   0},
+    {0x00B0, 0x00B1,  95},
+    {0x00B5, 0x00B5,  97},
+    {0x2190, 0x2193,  98}
+};
@@ -0,0 +1,231 @@
+/**
+ * 5x7 proportional font, in column-major page layout.
+ *
+ * The classic 5x7 LCD font with the blank columns trimmed, so narrow glyphs
+ * take less room: 14 to 20 characters on a line of 84 pixels.
+ *
+ * License: Public Domain
+ **/
+
+// Constants: font5x7_bitmap, font5x7_glyphs, font5x7_ranges
+// Each byte is a column of the glyph, the LSB is the top pixel. This is the
+// same layout as a bank of the frame buffer, so a glyph is a byte per column.
+// Covers U+0020 - U+007E, the degree, plus-minus and micro signs and the
+// arrows U+2190 - U+2193.
+
+static const uint8_t font5x7_bitmap[] = {
+    0x00, 0x00, 0x00,             // U+0020 ( )
+    0x5F,                         // U+0021 (!)
+    0x07, 0x00, 0x07,             // U+0022 (")
+    0x14, 0x7F, 0x14, 0x7F, 0x14, // U+0023 (#)
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, // U+0024 ($)
+    0x23, 0x13, 0x08, 0x64, 0x62, // U+0025 (%)
+    0x36, 0x49, 0x55, 0x22, 0x50, // U+0026 (&)
+    0x05, 0x03,                   // U+0027 (')
+    0x1C, 0x22, 0x41,             // U+0028 (()
+    0x41, 0x22, 0x1C,             // U+0029 ())
+    0x08, 0x2A, 0x1C, 0x2A, 0x08, // U+002A (*)
+    0x08, 0x08, 0x3E, 0x08, 0x08, // U+002B (+)
+    0x50, 0x30,                   // U+002C (,)
+    0x08, 0x08, 0x08, 0x08, 0x08, // U+002D (-)
+    0x60, 0x60,                   // U+002E (.)
+    0x20, 0x10, 0x08, 0x04, 0x02, // U+002F (/)
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // U+0030 (0)
+    0x42, 0x7F, 0x40,             // U+0031 (1)
+    0x42, 0x61, 0x51, 0x49, 0x46, // U+0032 (2)
+    0x21, 0x41, 0x45, 0x4B, 0x31, // U+0033 (3)
+    0x18, 0x14, 0x12, 0x7F, 0x10, // U+0034 (4)
+    0x27, 0x45, 0x45, 0x45, 0x39, // U+0035 (5)
+    0x3C, 0x4A, 0x49, 0x49, 0x30, // U+0036 (6)
+    0x01, 0x71, 0x09, 0x05, 0x03, // U+0037 (7)
+    0x36, 0x49, 0x49, 0x49, 0x36, // U+0038 (8)
+    0x06, 0x49, 0x49, 0x29, 0x1E, // U+0039 (9)
+    0x36, 0x36,                   // U+003A (:)
+    0x56, 0x36,                   // U+003B (;)
+    0x08, 0x14, 0x22, 0x41,       // U+003C (<)
+    0x14, 0x14, 0x14, 0x14, 0x14, // U+003D (=)
+    0x41, 0x22, 0x14, 0x08,       // U+003E (>)
+    0x02, 0x01, 0x51, 0x09, 0x06, // U+003F (?)
+    0x32, 0x49, 0x79, 0x41, 0x3E, // U+0040 (@)
+    0x7E, 0x11, 0x11, 0x11, 0x7E, // U+0041 (A)
+    0x7F, 0x49, 0x49, 0x49, 0x36, // U+0042 (B)
+    0x3E, 0x41, 0x41, 0x41, 0x22, // U+0043 (C)
+    0x7F, 0x41, 0x41, 0x22, 0x1C, // U+0044 (D)
+    0x7F, 0x49, 0x49, 0x49, 0x41, // U+0045 (E)
+    0x7F, 0x09, 0x09, 0x09, 0x01, // U+0046 (F)
+    0x3E, 0x41, 0x49, 0x49, 0x7A, // U+0047 (G)
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // U+0048 (H)
+    0x41, 0x7F, 0x41,             // U+0049 (I)
+    0x20, 0x40, 0x41, 0x3F, 0x01, // U+004A (J)
+    0x7F, 0x08, 0x14, 0x22, 0x41, // U+004B (K)
+    0x7F, 0x40, 0x40, 0x40, 0x40, // U+004C (L)
+    0x7F, 0x02, 0x0C, 0x02, 0x7F, // U+004D (M)
+    0x7F, 0x04, 0x08, 0x10, 0x7F, // U+004E (N)
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // U+004F (O)
+    0x7F, 0x09, 0x09, 0x09, 0x06, // U+0050 (P)
+    0x3E, 0x41, 0x51, 0x21, 0x5E, // U+0051 (Q)
+    0x7F, 0x09, 0x19, 0x29, 0x46, // U+0052 (R)
+    0x46, 0x49, 0x49, 0x49, 0x31, // U+0053 (S)
+    0x01, 0x01, 0x7F, 0x01, 0x01, // U+0054 (T)
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // U+0055 (U)
+    0x1F, 0x20, 0x40, 0x20, 0x1F, // U+0056 (V)
+    0x3F, 0x40, 0x38, 0x40, 0x3F, // U+0057 (W)
+    0x63, 0x14, 0x08, 0x14, 0x63, // U+0058 (X)
+    0x07, 0x08, 0x70, 0x08, 0x07, // U+0059 (Y)
+    0x61, 0x51, 0x49, 0x45, 0x43, // U+005A (Z)
+    0x7F, 0x41, 0x41,             // U+005B ([)
+    0x02, 0x04, 0x08, 0x10, 0x20, // U+005C (\)
+    0x41, 0x41, 0x7F,             // U+005D (])
+    0x04, 0x02, 0x01, 0x02, 0x04, // U+005E (^)
+    0x40, 0x40, 0x40, 0x40, 0x40, // U+005F (_)
+    0x01, 0x02, 0x04,             // U+0060 (`)
+    0x20, 0x54, 0x54, 0x54, 0x78, // U+0061 (a)
+    0x7F, 0x48, 0x44, 0x44, 0x38, // U+0062 (b)
+    0x38, 0x44, 0x44, 0x44, 0x20, // U+0063 (c)
+    0x38, 0x44, 0x44, 0x48, 0x7F, // U+0064 (d)
+    0x38, 0x54, 0x54, 0x54, 0x18, // U+0065 (e)
+    0x08, 0x7E, 0x09, 0x01, 0x02, // U+0066 (f)
+    0x0C, 0x52, 0x52, 0x52, 0x3E, // U+0067 (g)
+    0x7F, 0x08, 0x04, 0x04, 0x78, // U+0068 (h)
+    0x44, 0x7D, 0x40,             // U+0069 (i)
+    0x20, 0x40, 0x44, 0x3D,       // U+006A (j)
+    0x7F, 0x10, 0x28, 0x44,       // U+006B (k)
+    0x41, 0x7F, 0x40,             // U+006C (l)
+    0x7C, 0x04, 0x18, 0x04, 0x78, // U+006D (m)
+    0x7C, 0x08, 0x04, 0x04, 0x78, // U+006E (n)
+    0x38, 0x44, 0x44, 0x44, 0x38, // U+006F (o)
+    0x7C, 0x14, 0x14, 0x14, 0x08, // U+0070 (p)
+    0x08, 0x14, 0x14, 0x18, 0x7C, // U+0071 (q)
+    0x7C, 0x08, 0x04, 0x04, 0x08, // U+0072 (r)
+    0x48, 0x54, 0x54, 0x54, 0x20, // U+0073 (s)
+    0x04, 0x3F, 0x44, 0x40, 0x20, // U+0074 (t)
+    0x3C, 0x40, 0x40, 0x20, 0x7C, // U+0075 (u)
+    0x1C, 0x20, 0x40, 0x20, 0x1C, // U+0076 (v)
+    0x3C, 0x40, 0x30, 0x40, 0x3C, // U+0077 (w)
+    0x44, 0x28, 0x10, 0x28, 0x44, // U+0078 (x)
+    0x0C, 0x50, 0x50, 0x50, 0x3C, // U+0079 (y)
+    0x44, 0x64, 0x54, 0x4C, 0x44, // U+007A (z)
+    0x08, 0x36, 0x41,             // U+007B ({)
+    0x7F,                         // U+007C (|)
+    0x41, 0x36, 0x08,             // U+007D (})
+    0x08, 0x04, 0x08, 0x10, 0x08, // U+007E (~)
+    0x06, 0x09, 0x09, 0x06,       // U+00B0 (°)
+    0x44, 0x44, 0x5F, 0x44, 0x44, // U+00B1 (±)
+    0x7C, 0x20, 0x20, 0x10, 0x3C, // U+00B5 (µ)
+    0x08, 0x1C, 0x2A, 0x08, 0x08, // U+2190 (←)
+    0x04, 0x02, 0x7F, 0x02, 0x04, // U+2191 (↑)
+    0x08, 0x08, 0x2A, 0x1C, 0x08, // U+2192 (→)
+    0x10, 0x20, 0x7F, 0x20, 0x10  // U+2193 (↓)
+};
+
+static const font_glyph_t font5x7_glyphs[] = {
+    {   0, 3},      // U+0020 ( )
+    {   3, 1},      // U+0021 (!)
+    {   4, 3},      // U+0022 (")
+    {   7, 5},      // U+0023 (#)
+    {  12, 5},      // U+0024 ($)
+    {  17, 5},      // U+0025 (%)
+    {  22, 5},      // U+0026 (&)
+    {  27, 2},      // U+0027 (')
+    {  29, 3},      // U+0028 (()
+    {  32, 3},      // U+0029 ())
+    {  35, 5},      // U+002A (*)
+    {  40, 5},      // U+002B (+)
+    {  45, 2},      // U+002C (,)
+    {  47, 5},      // U+002D (-)
+    {  52, 2},      // U+002E (.)
+    {  54, 5},      // U+002F (/)
+    {  59, 5},      // U+0030 (0)
+    {  64, 3},      // U+0031 (1)
+    {  67, 5},      // U+0032 (2)
+    {  72, 5},      // U+0033 (3)
+    {  77, 5},      // U+0034 (4)
+    {  82, 5},      // U+0035 (5)
+    {  87, 5},      // U+0036 (6)
+    {  92, 5},      // U+0037 (7)
+    {  97, 5},      // U+0038 (8)
+    { 102, 5},      // U+0039 (9)
+    { 107, 2},      // U+003A (:)
+    { 109, 2},      // U+003B (;)
+    { 111, 4},      // U+003C (<)
+    { 115, 5},      // U+003D (=)
+    { 120, 4},      // U+003E (>)
+    { 124, 5},      // U+003F (?)
+    { 129, 5},      // U+0040 (@)
+    { 134, 5},      // U+0041 (A)
+    { 139, 5},      // U+0042 (B)
+    { 144, 5},      // U+0043 (C)
+    { 149, 5},      // U+0044 (D)
+    { 154, 5},      // U+0045 (E)
+    { 159, 5},      // U+0046 (F)
+    { 164, 5},      // U+0047 (G)
+    { 169, 5},      // U+0048 (H)
+    { 174, 3},      // U+0049 (I)
+    { 177, 5},      // U+004A (J)
+    { 182, 5},      // U+004B (K)
+    { 187, 5},      // U+004C (L)
+    { 192, 5},      // U+004D (M)
+    { 197, 5},      // U+004E (N)
+    { 202, 5},      // U+004F (O)
+    { 207, 5},      // U+0050 (P)
+    { 212, 5},      // U+0051 (Q)
+    { 217, 5},      // U+0052 (R)
+    { 222, 5},      // U+0053 (S)
+    { 227, 5},      // U+0054 (T)
+    { 232, 5},      // U+0055 (U)
+    { 237, 5},      // U+0056 (V)
+    { 242, 5},      // U+0057 (W)
+    { 247, 5},      // U+0058 (X)
+    { 252, 5},      // U+0059 (Y)
+    { 257, 5},      // U+005A (Z)
+    { 262, 3},      // U+005B ([)
+    { 265, 5},      // U+005C (\)
+    { 270, 3},      // U+005D (])
+    { 273, 5},      // U+005E (^)
+    { 278, 5},      // U+005F (_)
+    { 283, 3},      // U+0060 (`)
+    { 286, 5},      // U+0061 (a)
+    { 291, 5},      // U+0062 (b)
+    { 296, 5},      // U+0063 (c)
+    { 301, 5},      // U+0064 (d)
+    { 306, 5},      // U+0065 (e)
+    { 311, 5},      // U+0066 (f)
+    { 316, 5},      // U+0067 (g)
+    { 321, 5},      // U+0068 (h)
+    { 326, 3},      // U+0069 (i)
+    { 329, 4},      // U+006A (j)
+    { 333, 4},      // U+006B (k)
+    { 337, 3},      // U+006C (l)
+    { 340, 5},      // U+006D (m)
+    { 345, 5},      // U+006E (n)
+    { 350, 5},      // U+006F (o)
+    { 355, 5},      // U+0070 (p)
+    { 360, 5},      // U+0071 (q)
+    { 365, 5},      // U+0072 (r)
+    { 370, 5},      // U+0073 (s)
+    { 375, 5},      // U+0074 (t)
+    { 380, 5},      // U+0075 (u)
+    { 385, 5},      // U+0076 (v)
+    { 390, 5},      // U+0077 (w)
+    { 395, 5},      // U+0078 (x)
+    { 400, 5},      // U+0079 (y)
+    { 405, 5},      // U+007A (z)
+    { 410, 3},      // U+007B ({)
+    { 413, 1},      // U+007C (|)
+    { 414, 3},      // U+007D (})
+    { 417, 5},      // U+007E (~)
+    { 422, 4},      // U+00B0 (°)
+    { 426, 5},      // U+00B1 (±)
+    { 431, 5},      // U+00B5 (µ)
+    { 436, 5},      // U+2190 (←)
+    { 441, 5},      // U+2191 (↑)
+    { 446, 5},      // U+2192 (→)
+    { 451, 5}       // U+2193 (↓)
+};
+
+static const font_range_t font5x7_ranges[] = {
+    {0x0020, 0x007E,   0},
+    {0x00B0, 0x00B1,  95},
+    {0x00B5, 0x00B5,  97},
+    {0x2190, 0x2193,  98}
+};
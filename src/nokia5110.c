@@ -1,6 +1,7 @@
 #include <mruby.h>
 #include <mruby/array.h>
 #include <mruby/class.h>
+#include <mruby/hash.h>
 #include <mruby/string.h>
 #include <mruby/value.h>
 #include <mruby/variable.h>
@@ -9,89 +10,64 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "esp_log.h"
-#include "driver/spi_master.h"
-#include "soc/gpio_struct.h"
-#include "driver/gpio.h"
-#include "esp_heap_caps.h"
 
 #include "tiny_grafx.h"
-
-// PCD8544 function set
-#define PCD8544_FUNCTIONSET     0x20
-#define PCD8544_POWERDOWN       0x04
-#define PCD8544_VADDRMODE       0x02
-#define PCD8544_EXTINSTRUCTION  0x01
-#define PCD8544_DISPLAYBLANK    0x0
-#define PCD8544_DISPLAYNORMAL   0x4
-#define PCD8544_DISPLAYALLON    0x1
-#define PCD8544_DISPLAYINVERSE  0x5
-
-// PCD8544 basic instruction set
-#define PCD8544_DISPLAYCTRL     0x08
-#define PCD8544_SETYADDR        0x40
-#define PCD8544_SETXADDR        0x80
-
-// PCD8544 extended instruction set
-#define PCD8544_SETTEMP         0x04
-#define PCD8544_SETBIAS         0x10
-#define PCD8544_SETVOP          0x80
-
-// PCD8544 display config
-#define PCD8544_DISPLAY_WIDTH   84
-#define PCD8544_DISPLAY_HEIGHT  48
-#define PCD8544_DISPLAY_PIXEL   504
-#define PCD8544_FONT_WIDTH      8
-#define PCD8544_FONT_HEIGHT     8 
-
-// D/C pin mode, command or data
+#include "pcd8544.h"
+#include "canvas.h"
+#include "console.h"
+#include "font.h"
+#include "rle.h"
+#include "anim.h"
+#include "dither.h"
+
+// Batch drawing commands
 enum {
-    DC_CMD,
-    DC_DATA
+  CMD_CLEAR,        // CMD_CLEAR
+  CMD_COLOR,        // CMD_COLOR, color
+  CMD_FONTSIZE,     // CMD_FONTSIZE, fontsize
+  CMD_PIXEL,        // CMD_PIXEL, x, y
+  CMD_LINE,         // CMD_LINE, x0, y0, x1, y1
+  CMD_VLINE,        // CMD_VLINE, x, y, h
+  CMD_HLINE,        // CMD_HLINE, x, y, w
+  CMD_RECT,         // CMD_RECT, x, y, w, h
+  CMD_FILL_RECT,    // CMD_FILL_RECT, x, y, w, h
+  CMD_CIRCLE,       // CMD_CIRCLE, x, y, r
+  CMD_FILL_CIRCLE,  // CMD_FILL_CIRCLE, x, y, r
+  CMD_TEXT,         // CMD_TEXT, x, y, "text" (Array command list only)
+  CMD_FILL_TRIANGLE,    // CMD_FILL_TRIANGLE, x0, y0, x1, y1, x2, y2
+  CMD_FILL_ELLIPSE,     // CMD_FILL_ELLIPSE, x, y, rx, ry
+  CMD_FILL_ROUND_RECT,  // CMD_FILL_ROUND_RECT, x, y, w, h, r
+  CMD_FILL_POLYGON,     // CMD_FILL_POLYGON, n, x0, y0, ... x(n-1), y(n-1)
+  CMD_CLIP,             // CMD_CLIP, x, y, w, h
+  CMD_ORIGIN,           // CMD_ORIGIN, x, y
+  CMD_SCROLL,           // CMD_SCROLL, dx, dy, color
+  CMD_SCROLL_REGION     // CMD_SCROLL_REGION, x, y, w, h, dx, dy, color
 };
 
-// DMA channel
-#define NO_DMA  0
-#define DMA_CH1 1
-#define DMA_CH2 2
-
-// NO_DMA mode transaction data size is up to 32 bytes at a time.
-#define NO_DMA_TRANSACTION_DATA_SIZE 32 
-
-// default pcd8544 wiring and SPI configuration
-#define PCD8544_PIN_NUM_CS   5
-#define PCD8544_PIN_NUM_DC   16
-#define PCD8544_PIN_NUM_RST  17
-#define PCD8544_PIN_NUM_MOSI 23
-#define PCD8544_PIN_NUM_SCK  18
-#define PCD8544_PIN_NUM_MISO 19
-#define PCD8544_CLOCK_SPEED_HZ (4*1000*1000)   // SPI Clock freq=4 MHz
-#define PCD8544_SPI_MODE 0
-#define PCD8544_DMA DMA_CH1                    // default DMA channel = 1
-
-// SPI HOST, only HSPI or VSPI
-#define PCD8544_HOST VSPI_HOST
-
-// SPI Object start
-typedef struct spi_config_t {
-  uint8_t num_cs;           // Chip Select pin num
-  uint8_t num_dc;           // Data/Command select pin num
-  uint8_t num_rst;          // RESET pin num
-  uint8_t num_mosi;         // MOSI pin num
-  uint8_t num_sck;          // SPI Clock pin num
-  uint8_t num_miso;         // MISO pin num
-  uint32_t spi_freq;        // SPI clock frequency [Hz]
-  uint8_t spi_mode;         // SPI mode (0-3)
-  uint8_t dma_ch;           // No DMA or DMA channel (1 or 2)
-  bool require_reset;       // Reset the display
-  spi_device_handle_t spi;  // Handle for a device on a SPI bus
-  tinygrafx_t tinygrafx;    // Tiny graphics config and frame buffer
-} spi_config_t;
-
 static const char *TAG = "PCD8544";
 
+// free mrb object for GC, the frame buffer goes back to the pool
+static void
+mrb_canvas_free(mrb_state *mrb, void *ptr)
+{
+  canvas_close((canvas_t *)ptr);
+  mrb_free(mrb, ptr);
+}
+
+static const struct mrb_data_type mrb_canvas_type = {
+  "LCD::Canvas", mrb_canvas_free
+};
+
+// Drawing state of the receiver, a panel or a canvas
+static draw_state_t *
+draw_state(mrb_state *mrb, mrb_value self)
+{
+  if (DATA_TYPE(self) == &mrb_canvas_type) {
+    return &((canvas_t *)DATA_PTR(self))->draw;
+  }
+  return &((spi_config_t *)DATA_PTR(self))->draw;
+}
+
 
 // ----- Common graphics methods ----------
 // mruby binding of manipulate the graphics
@@ -99,9 +75,9 @@ static const char *TAG = "PCD8544";
 static mrb_value
 lcd_clear(mrb_state *mrb, mrb_value self)
 {
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
+  draw_state_t *tg = draw_state(mrb, self);
 
-  buffer_clear(tg->tinygrafx);
+  buffer_clear(&tg->tinygrafx);
   return self;
 }
 
@@ -110,11 +86,12 @@ lcd_set_pixel(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "ii", &x, &y);
 	
-  set_pixel(tg->tinygrafx, x, y, color);
+  tg->draw_calls[STAT_PIXEL]++;
+  set_pixel(&tg->tinygrafx, x, y, color);
   return mrb_nil_value();
 }
 
@@ -123,10 +100,10 @@ lcd_get_pixel(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y;
   int16_t pixel;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
+  draw_state_t *tg = draw_state(mrb, self);
   mrb_get_args(mrb, "ii", &x, &y);
 	
-  pixel = get_pixel(tg->tinygrafx, x, y);
+  pixel = get_pixel(&tg->tinygrafx, x, y);
   return mrb_fixnum_value(pixel);
 }
 
@@ -135,14 +112,12 @@ lcd_draw_line(mrb_state *mrb, mrb_value self)
 {
   mrb_int x0, y0, x1, y1;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iiii", &x0, &y0, &x1, &y1);
-  if ((color < BLACK) || (color > INVERT)) {
-    color = WHITE;
-  }
   
-  draw_line(tg->tinygrafx, x0, y0, x1, y1, color);
+  tg->draw_calls[STAT_LINE]++;
+  draw_line(&tg->tinygrafx, x0, y0, x1, y1, color);
   return mrb_nil_value();
 }
 
@@ -151,11 +126,12 @@ lcd_draw_vertical_line(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y, h;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iii", &x, &y, &h);
 	
-  draw_vertical_line(tg->tinygrafx, x, y, h, color);
+  tg->draw_calls[STAT_VLINE]++;
+  draw_vertical_line(&tg->tinygrafx, x, y, h, color);
   return mrb_nil_value();
 }
 
@@ -164,11 +140,12 @@ lcd_draw_horizontal_line(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y, w;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iii", &x, &y, &w);
 	
-  draw_horizontal_line(tg->tinygrafx, x, y, w, color);
+  tg->draw_calls[STAT_HLINE]++;
+  draw_horizontal_line(&tg->tinygrafx, x, y, w, color);
 	return mrb_nil_value();
 }
 
@@ -177,11 +154,12 @@ lcd_draw_rect(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y, w, h;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iiii", &x, &y, &w, &h);
 	
-  draw_rect(tg->tinygrafx, x, y, w, h, color);
+  tg->draw_calls[STAT_RECT]++;
+  draw_rect(&tg->tinygrafx, x, y, w, h, color);
 	return mrb_nil_value();
 }
 
@@ -190,11 +168,12 @@ lcd_draw_fill_rect(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y, w, h;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iiii", &x, &y, &w, &h);
 	
-  draw_fill_rect(tg->tinygrafx, x, y, w, h, color);
+  tg->draw_calls[STAT_FILL_RECT]++;
+  draw_fill_rect(&tg->tinygrafx, x, y, w, h, color);
 	return mrb_nil_value();
 }
 
@@ -203,11 +182,12 @@ lcd_draw_circle(mrb_state *mrb, mrb_value self)
 {
 	mrb_int x, y, r;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iii", &x, &y, &r);
 	
-  draw_circle(tg->tinygrafx, x, y, r, color);
+  tg->draw_calls[STAT_CIRCLE]++;
+  draw_circle(&tg->tinygrafx, x, y, r, color);
 	return mrb_nil_value();
 }
 
@@ -216,365 +196,1509 @@ lcd_draw_fill_circle(mrb_state *mrb, mrb_value self)
 {
   mrb_int x, y, r;
   int16_t color;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
   mrb_get_args(mrb, "iii", &x, &y, &r);
 	
-  draw_fill_circle(tg->tinygrafx, x, y, r, color);
+  tg->draw_calls[STAT_FILL_CIRCLE]++;
+  draw_fill_circle(&tg->tinygrafx, x, y, r, color);
 	return mrb_nil_value();
 }
 
-// mruby binding of Display a character string
 static mrb_value
-lcd_text(mrb_state *mrb, mrb_value self)
+lcd_draw_fill_ellipse(mrb_state *mrb, mrb_value self)
 {
-  mrb_int x, y;
-  mrb_value data;
-  int16_t color, fontsize;
-  spi_config_t *tg = (spi_config_t *)DATA_PTR(self);
-  color = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@color")));
-  fontsize = mrb_fixnum(mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@fontsize")));
-  mrb_get_args(mrb, "iiS", &x, &y, &data);
-  
-  display_text(tg->tinygrafx, x, y, RSTRING_PTR(data), RSTRING_LEN(data), color, fontsize);
-  // ESP_LOGI(TAG, "color:%d, size:%d, text:%s", color, fontsize, RSTRING_PTR(data));
+  mrb_int x, y, rx, ry;
+  int16_t color;
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
+  mrb_get_args(mrb, "iiii", &x, &y, &rx, &ry);
+
+  tg->draw_calls[STAT_FILL_ELLIPSE]++;
+  draw_fill_ellipse(&tg->tinygrafx, x, y, rx, ry, color);
   return mrb_nil_value();
 }
-// ----- Common graphics methods -----
 
+static mrb_value
+lcd_draw_fill_round_rect(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y, w, h, r;
+  int16_t color;
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
+  mrb_get_args(mrb, "iiiii", &x, &y, &w, &h, &r);
 
+  tg->draw_calls[STAT_FILL_ROUND_RECT]++;
+  draw_fill_round_rect(&tg->tinygrafx, x, y, w, h, r, color);
+  return mrb_nil_value();
+}
 
+static mrb_value
+lcd_draw_fill_triangle(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x0, y0, x1, y1, x2, y2;
+  int16_t color;
+  draw_state_t *tg = draw_state(mrb, self);
+  color = tg->color;
+  mrb_get_args(mrb, "iiiiii", &x0, &y0, &x1, &y1, &x2, &y2);
 
-// ----- PCD8544 methods and functions -----
+  tg->draw_calls[STAT_FILL_TRIANGLE]++;
+  draw_fill_triangle(&tg->tinygrafx, x0, y0, x1, y1, x2, y2, color);
+  return mrb_nil_value();
+}
 
+static int16_t
+point_int(mrb_state *mrb, mrb_value v)
+{
+  if (!mrb_fixnum_p(v)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "polygon: expected Integer");
+  }
+  return mrb_fixnum(v);
+}
 
-/* -----------------------------------------------------------
-    Note: The following two functions are not used. 
-    Because this function cannot specify any other arguments.
-   ----------------------------------------------------------- */
-// // This function is called (in irq context!) just before a transmission starts.
-// // It will set the D/C line to the value indicated in the user field.
-// static void
-// spi_pre_transfer_callback(spi_transaction_t *t)
-// {
-//   uint32_t dc = (uint32_t)t->user;
-//   gpio_set_level(PCD8544_PIN_NUM_DC, dc);
-// }
-// // reset the D/C line
-// static void
-// spi_post_transfer_callback(spi_transaction_t *t)
-// {
-//   gpio_set_level(PCD8544_PIN_NUM_DC, 0);
-// }
+// Read the points of a polygon into "points", returns the number of points.
+// The list is a flat Array [x0, y0, x1, y1, ...], an Array of [x, y] pairs,
+// or a String of packed 16 bit little-endian integers, e.g. Array#pack("s<*").
+static int16_t
+read_points(mrb_state *mrb, mrb_value list, int16_t *points)
+{
+  mrb_int len;
 
-// Send buffer data to the display
-// NOTE: NO_DMA mode can transmit up to 32 bytes at a time.
-static void
-send_data(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
-{
-  esp_err_t err;
-  spi_transaction_t tx;
-
-  // spi pre-transfer setting, control lines.
-  gpio_set_level(spicfg->num_cs, 0);
-  gpio_set_level(spicfg->num_dc, dc);
-
-  if (spicfg->dma_ch == 0) {
-    // NO_DMA mode
-    int16_t max_len, tx_len, left_len;
-    void *cur_data = (void *)data;
-    max_len = NO_DMA_TRANSACTION_DATA_SIZE;
-    left_len = len;
-    // Split transmission with 32 bytes
-    while (left_len > 0) {
-      tx_len = (left_len > max_len) ? max_len : left_len;
-      memset(&tx, 0, sizeof(tx));
-      tx.length = tx_len * 8;   // tx_len is in bytes, transaction length is in bits.
-      tx.tx_buffer = cur_data;  // Transmit data
-      tx.user = (void*)dc;      // D/C needs to be set to 1
-      err = spi_device_queue_trans(spicfg->spi, &tx, 1000 / portTICK_PERIOD_MS);
-      if (err != ESP_OK) {
-        ESP_LOGI(TAG, "send_data: spi_device_queue_trans error=%d", err);
-      }
-      spi_transaction_t *rx;
-      err = spi_device_get_trans_result(spicfg->spi, &rx, 1000 / portTICK_PERIOD_MS);
-      if (err != ESP_OK) {
-        ESP_LOGI(TAG, "send_data: spi_device_get_trans_result error=%d", err);
-      }
-      left_len -= tx_len;
-      cur_data += tx_len;
+  if (mrb_string_p(list)) {
+    const uint8_t *p = (const uint8_t *)RSTRING_PTR(list);
+    len = RSTRING_LEN(list) / 2;
+    if ((len % 2) || (len > 2 * TINYGRAFX_POLYGON_MAX)) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "polygon: bad number of coordinates");
     }
-  } else {
-    // Use DMA mode
-    memset(&tx, 0, sizeof(tx));
-    tx.length = len * 8;        // len is in bytes, transaction length is in bits.
-    tx.tx_buffer = data;        // Transmit data
-    tx.user = (void*)dc;        // D/C needs to be set to 1
-    err = spi_device_queue_trans(spicfg->spi, &tx, 1000 / portTICK_PERIOD_MS);
-    if (err != ESP_OK) {
-      ESP_LOGI(TAG, "send_data: spi_device_queue_trans error=%d", err);
+    for (mrb_int i = 0; i < len; i++) {
+      points[i] = (int16_t)(p[2 * i] | (p[2 * i + 1] << 8));
     }
-    spi_transaction_t *rx;
-    err = spi_device_get_trans_result(spicfg->spi, &rx, 1000 / portTICK_PERIOD_MS);
-    if (err != ESP_OK) {
-      ESP_LOGI(TAG, "send_data: spi_device_get_trans_result error=%d", err);
+    return len / 2;
+  }
+  if (!mrb_array_p(list)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "polygon: expected Array or String");
+  }
+
+  len = RARRAY_LEN(list);
+  if ((len > 0) && mrb_array_p(mrb_ary_ref(mrb, list, 0))) {
+    if (len > TINYGRAFX_POLYGON_MAX) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "polygon: too many points");
+    }
+    for (mrb_int i = 0; i < len; i++) {
+      mrb_value pt = mrb_ary_ref(mrb, list, i);
+      if (!mrb_array_p(pt) || (RARRAY_LEN(pt) != 2)) {
+        mrb_raise(mrb, E_TYPE_ERROR, "polygon: expected [x, y]");
+      }
+      points[2 * i] = point_int(mrb, mrb_ary_ref(mrb, pt, 0));
+      points[2 * i + 1] = point_int(mrb, mrb_ary_ref(mrb, pt, 1));
     }
+    return len;
+  }
+  if ((len % 2) || (len > 2 * TINYGRAFX_POLYGON_MAX)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "polygon: bad number of coordinates");
   }
-  // spi post-transfer setting, control lines.
-  gpio_set_level(spicfg->num_dc, 0);
-  gpio_set_level(spicfg->num_cs, 1);
+  for (mrb_int i = 0; i < len; i++) {
+    points[i] = point_int(mrb, mrb_ary_ref(mrb, list, i));
+  }
+  return len / 2;
 }
 
-// write address config. use horizontal addressing mode.
-DRAM_ATTR static const uint8_t pcd8544_address_init[] = {
-  (PCD8544_FUNCTIONSET),                        // use basic instruction set
-  (PCD8544_DISPLAYCTRL|PCD8544_DISPLAYNORMAL),  // display config = normal mode
-  (PCD8544_SETXADDR),                           // set X address = 0
-  (PCD8544_SETYADDR)                            // set Y address = 0
-};
+static mrb_value
+lcd_draw_fill_polygon(mrb_state *mrb, mrb_value self)
+{
+  mrb_value list;
+  int16_t points[2 * TINYGRAFX_POLYGON_MAX];
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "o", &list);
+
+  int16_t n = read_points(mrb, list, points);
+  tg->draw_calls[STAT_FILL_POLYGON]++;
+  draw_fill_polygon(&tg->tinygrafx, points, n, tg->color);
+  return mrb_nil_value();
+}
 
-// Send buffer to display
-static void
-pcd8544_send_display(spi_config_t *spicfg)
+// mruby binding of blit a 1bpp bitmap
+static mrb_value
+lcd_blit(mrb_state *mrb, mrb_value self)
 {
-  uint8_t *buffer;
+  mrb_int x, y, w, h;
+  mrb_int rop = BLIT_OR;
+  mrb_value bitmap, mask = mrb_nil_value();
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "iiiiS|iS!", &x, &y, &w, &h, &bitmap, &rop, &mask);
+
+  // blit takes 16-bit positions and sizes
+  if ((x < INT16_MIN) || (x > INT16_MAX) || (y < INT16_MIN) || (y > INT16_MAX) ||
+      (w > INT16_MAX) || (h > INT16_MAX)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "blit: position or size out of range");
+  }
+  mrb_int size = w * ((h + 7) / 8);
+  if ((w < 0) || (h < 0) || (RSTRING_LEN(bitmap) < size)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "bitmap is smaller than w * h");
+  }
+  if ((rop < BLIT_COPY) || (rop > BLIT_MASKED)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unknown raster operation");
+  }
+  if (!mrb_nil_p(mask) && (RSTRING_LEN(mask) < size)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "mask is smaller than w * h");
+  }
 
-  if (spicfg->dma_ch == 0) {
-    // NO DMA
-    buffer = (uint8_t *)malloc(spicfg->tinygrafx.display_pixel);
-  } else {
-    // Use DMA_CH1 or DMA_CH2
-    buffer = (uint8_t *)heap_caps_malloc(spicfg->tinygrafx.display_pixel, MALLOC_CAP_DMA);
+  tg->draw_calls[STAT_BLIT]++;
+  blit(&tg->tinygrafx, x, y, (uint8_t *)RSTRING_PTR(bitmap), 
+       mrb_nil_p(mask) ? NULL : (uint8_t *)RSTRING_PTR(mask), w, h, rop);
+  return mrb_nil_value();
+}
+
+// Check the size of an 8-bit grayscale image String
+static void
+check_gray_image(mrb_state *mrb, mrb_int w, mrb_int h, mrb_value gray)
+{
+  if ((w <= 0) || (w > DITHER_MAX_WIDTH) || (h <= 0) || (h > 255)) {
+    mrb_raisef(mrb, E_ARGUMENT_ERROR, "bad size, 1 to %S pixels wide and 1 to 255 high", mrb_fixnum_value(DITHER_MAX_WIDTH));
   }
+  if (RSTRING_LEN(gray) < w * h) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "image is smaller than w * h");
+  }
+}
 
-  if (buffer != NULL) {
-    memset(buffer, 0x00, spicfg->tinygrafx.display_pixel);
-    buffer_read(spicfg->tinygrafx, buffer, spicfg->tinygrafx.display_pixel);
-    // send buffer to pcd8544
-    send_data(spicfg, pcd8544_address_init, sizeof(pcd8544_address_init), DC_CMD);
-    send_data(spicfg, buffer, spicfg->tinygrafx.display_pixel, DC_DATA);
+// Draw an 8-bit grayscale image String with ordered dithering or error
+// diffusion, see dither.h
+static mrb_value
+lcd_dither(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y, w, h;
+  mrb_int method = DITHER_BAYER;
+  mrb_value gray;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "iiiiS|i", &x, &y, &w, &h, &gray, &method);
+
+  check_gray_image(mrb, w, h, gray);
+  if ((method != DITHER_BAYER) && (method != DITHER_DIFFUSION)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "dither: unknown method");
   }
+  tg->draw_calls[STAT_DITHER]++;
+  dither_draw(&tg->tinygrafx, x, y, (const uint8_t *)RSTRING_PTR(gray), w, h, method);
+  return mrb_nil_value();
+}
 
-  if (spicfg->dma_ch == 0) {
-    free(buffer);
-  } else {
-    heap_caps_free(buffer);
+// mruby binding of compose a canvas with one blit
+static mrb_value
+lcd_draw_canvas(mrb_state *mrb, mrb_value self)
+{
+  mrb_value src;
+  mrb_int x, y;
+  mrb_int rop = BLIT_OR;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "oii|i", &src, &x, &y, &rop);
+
+  canvas_t *canvas = (canvas_t *)mrb_data_get_ptr(mrb, src, &mrb_canvas_type);
+  if (canvas == NULL) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "draw_canvas: expected an LCD::Canvas");
+  }
+  if ((rop < BLIT_COPY) || (rop > BLIT_MASKED)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unknown raster operation");
   }
+
+  tinygrafx_t *ctg = &canvas->draw.tinygrafx;
+  tg->draw_calls[STAT_BLIT]++;
+  blit(&tg->tinygrafx, x, y, ctg->display_buffer, NULL, ctg->display_width, ctg->display_height, rop);
+  return mrb_nil_value();
 }
 
-// display the frame buffer
+// Draw a run-length compressed image, see rle.h.
+// The data is a String, or the chunks returned by the block until it
+// returns nil.
 static mrb_value
-pcd8544_spi_display(mrb_state *mrb, mrb_value self)
+lcd_draw_rle(mrb_state *mrb, mrb_value self)
 {
-  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
-  pcd8544_send_display(spicfg);
+  mrb_int x, y;
+  mrb_int rop = BLIT_COPY;
+  mrb_value data = mrb_nil_value(), block = mrb_nil_value();
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "ii|S!i&", &x, &y, &data, &rop, &block);
+
+  if ((rop < BLIT_COPY) || (rop > BLIT_ERASE)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unknown raster operation");
+  }
+  if (mrb_nil_p(data) && mrb_nil_p(block)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "draw_rle: expected a String or a block");
+  }
+
+  rle_decoder_t dec;
+  esp_err_t err = ESP_OK;
+  tg->draw_calls[STAT_RLE]++;
+  rle_begin(&dec, &tg->tinygrafx, x, y, rop);
+  if (!mrb_nil_p(data)) {
+    err = rle_feed(&dec, (const uint8_t *)RSTRING_PTR(data), RSTRING_LEN(data));
+  }
+  while ((err == ESP_OK) && !rle_done(&dec) && !mrb_nil_p(block)) {
+    mrb_value chunk = mrb_yield_argv(mrb, block, 0, NULL);
+    if (mrb_nil_p(chunk)) break;
+    if (!mrb_string_p(chunk)) {
+      mrb_raise(mrb, E_TYPE_ERROR, "draw_rle: expected String");
+    }
+    // the frame buffers swap when the block displays a frame
+    dec.tg = tg->tinygrafx;
+    err = rle_feed(&dec, (const uint8_t *)RSTRING_PTR(chunk), RSTRING_LEN(chunk));
+  }
+  if ((err == ESP_OK) && !rle_done(&dec)) {
+    err = ESP_ERR_INVALID_SIZE;
+  }
+  if (err == ESP_ERR_INVALID_ARG) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "draw_rle: not an RLE image");
+  } else if (err != ESP_OK) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "draw_rle: the data doesn't match the image size");
+  }
   return mrb_nil_value();
 }
 
-// Initialize the SPI manter
+// Draw UTF-8 text in the font of the drawing state.
+// fontsize scales the 8x8 font only.
 static void
-spi_bus_init(spi_config_t *spicfg)
-{
-  spi_bus_config_t buscfg = {
-    .miso_io_num = spicfg->num_miso,
-    .mosi_io_num = spicfg->num_mosi,
-    .sclk_io_num = spicfg->num_sck,
-    .quadwp_io_num = -1,  // WP (Write Protect) signal, or -1 if not used.
-    .quadhd_io_num = -1   // HD (HolD) signal, or -1 if not used.
-  };
-  spi_device_interface_config_t devcfg = {
-    .clock_speed_hz = spicfg->spi_freq,
-    .mode = spicfg->spi_mode,
-    .spics_io_num = spicfg->num_cs,
-    .queue_size = 1,
-    .pre_cb = NULL,     // spi_pre_transfer_callback,
-    .post_cb = NULL     // spi_post_transfer_callback
-  };
-  esp_err_t err;
-  spi_device_handle_t spi;
+draw_text(draw_state_t *tg, int16_t x, int16_t y, const char *text, int16_t length)
+{
+  const font_t *font = (tg->font != NULL) ? tg->font : &font_8x8;
+
+  tg->draw_calls[STAT_TEXT]++;
+  if ((font == &font_8x8) && (tg->fontsize > 1)) {
+    display_text(&tg->tinygrafx, x, y, (uint8_t *)text, length, tg->color, tg->fontsize);
+  } else {
+    font_draw_text(&tg->tinygrafx, font, x, y, (const uint8_t *)text, length, tg->color);
+  }
+}
+
+// mruby binding of Display a character string
+static mrb_value
+lcd_text(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y;
+  mrb_value data;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "iiS", &x, &y, &data);
   
-  // Initialize the SPI bus
-  err = spi_bus_initialize(PCD8544_HOST, &buscfg, spicfg->dma_ch);
-  spicfg->require_reset = (err == ESP_ERR_INVALID_STATE) ? false : true;
-  if (err != ESP_OK) {
-    ESP_LOGI(TAG, "spi_bus_init: spi_bus_initialize status=%d", err);
+  draw_text(tg, x, y, RSTRING_PTR(data), RSTRING_LEN(data));
+  // ESP_LOGI(TAG, "color:%d, size:%d, text:%s", color, fontsize, RSTRING_PTR(data));
+  return mrb_nil_value();
+}
+
+// Width of the text in pixels, the widest line of a multi-line text
+static mrb_value
+lcd_text_width(mrb_state *mrb, mrb_value self)
+{
+  mrb_value data;
+  draw_state_t *tg = draw_state(mrb, self);
+  const font_t *font = (tg->font != NULL) ? tg->font : &font_8x8;
+  mrb_get_args(mrb, "S", &data);
+
+  int16_t width = font_text_width(font, (const uint8_t *)RSTRING_PTR(data), RSTRING_LEN(data));
+  if ((font == &font_8x8) && (tg->fontsize > 1)) {
+    width *= (tg->fontsize & 0x01) + (tg->fontsize / 2);
   }
+  return mrb_fixnum_value(width);
+}
 
-  // Attach the OLED to the SPI bus
-  err = spi_bus_add_device(PCD8544_HOST, &devcfg, &spi);
-  if (err != ESP_OK) {
-    ESP_LOGI(TAG, "spi_bus_init: spi_bus_add_device status=%d", err);
+// Get and set the drawing color
+static mrb_value
+lcd_get_color(mrb_state *mrb, mrb_value self)
+{
+  draw_state_t *tg = draw_state(mrb, self);
+  return mrb_fixnum_value(tg->color);
+}
+
+static mrb_value
+lcd_set_color(mrb_state *mrb, mrb_value self)
+{
+  mrb_int color;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "i", &color);
+  if ((color < BLACK) || (color > INVERT)) {
+    color = WHITE;
   }
-  // Save the SPI device handle to SPI Object.
-  spicfg->spi = spi;
+  tg->color = color;
+  return mrb_fixnum_value(color);
 }
 
-static void
-spi_deinit(spi_config_t *spicfg)
+// Name of the text font
+static mrb_value
+lcd_get_font(mrb_state *mrb, mrb_value self)
 {
-  free(spicfg->tinygrafx.display_buffer);
-  free(spicfg->spi);
+  draw_state_t *tg = draw_state(mrb, self);
+  const font_t *font = (tg->font != NULL) ? tg->font : &font_8x8;
+  return mrb_str_new_cstr(mrb, font->name);
 }
 
-// pcd8544 init commands
-DRAM_ATTR static const uint8_t pcd8544_init_cmds[] = {
-  (PCD8544_FUNCTIONSET|PCD8544_EXTINSTRUCTION), // use extended instruction set
-  (PCD8544_SETTEMP|0x00),                       // set temperature coefficient
-  (PCD8544_SETBIAS|0x03),                       // set bias system
-  (PCD8544_SETVOP|0x39)                         // set contrast
-};
+// Select the text font by name, see LCD.fonts
+static mrb_value
+lcd_set_font(mrb_state *mrb, mrb_value self)
+{
+  char *name;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "z", &name);
 
-// pcd8544 Initialize
-static void
-pcd8544_init(spi_config_t *spicfg)
+  const font_t *font = font_find(name);
+  if (font == NULL) {
+    mrb_raisef(mrb, E_ARGUMENT_ERROR, "font: unknown font %S", mrb_str_new_cstr(mrb, name));
+  }
+  tg->font = font;
+  return mrb_str_new_cstr(mrb, font->name);
+}
+
+// Compress a bitmap String in the page layout for draw_rle
+static mrb_value
+lcd_rle_encode(mrb_state *mrb, mrb_value self)
 {
-  // Initialize non-SPI GPIOs
-  gpio_set_direction(spicfg->num_dc, GPIO_MODE_OUTPUT);
-  gpio_set_direction(spicfg->num_rst, GPIO_MODE_OUTPUT);
-  gpio_set_direction(spicfg->num_cs, GPIO_MODE_OUTPUT);
-  gpio_set_pull_mode(spicfg->num_cs, GPIO_PULLUP_ONLY);
+  mrb_value bitmap;
+  mrb_int w, h;
+  mrb_get_args(mrb, "Sii", &bitmap, &w, &h);
 
-  // Reset the display if host not in use
-  if (spicfg->require_reset) {
-    gpio_set_level(spicfg->num_rst, 1);
-    gpio_set_level(spicfg->num_rst, 0);
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-    gpio_set_level(spicfg->num_rst, 1);
+  if ((w <= 0) || (w > 255) || (h <= 0) || (h > 255)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "rle_encode: bad size, 1 to 255 pixels");
   }
+  if (RSTRING_LEN(bitmap) < w * ((h + 7) / 8)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "bitmap is smaller than w * h");
+  }
+  mrb_value out = mrb_str_new_capa(mrb, RLE_ENCODED_MAX(w, h));
+  int32_t len = rle_encode((const uint8_t *)RSTRING_PTR(bitmap), w, h, (uint8_t *)RSTRING_PTR(out), RLE_ENCODED_MAX(w, h));
+  return mrb_str_resize(mrb, out, len);
+}
+
+// Size of an RLE image as [w, h]
+static mrb_value
+lcd_rle_size(mrb_state *mrb, mrb_value self)
+{
+  mrb_value data;
+  int16_t w, h;
+  mrb_get_args(mrb, "S", &data);
 
-  // Send all commands
-  send_data(spicfg, pcd8544_init_cmds, sizeof(pcd8544_init_cmds), DC_CMD);
+  if (rle_size((const uint8_t *)RSTRING_PTR(data), RSTRING_LEN(data), &w, &h) != ESP_OK) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "rle_size: not an RLE image");
+  }
+  mrb_value size[2] = { mrb_fixnum_value(w), mrb_fixnum_value(h) };
+  return mrb_ary_new_from_values(mrb, 2, size);
 }
 
-// Configuration the Tiny graphics libraries
-static void
-tinygrafx_init(spi_config_t *spicfg)
+// Names of the fonts
+static mrb_value
+lcd_fonts(mrb_state *mrb, mrb_value self)
 {
-  tinygrafx_t tg = {
-    .display_width = PCD8544_DISPLAY_WIDTH,
-    .display_height = PCD8544_DISPLAY_HEIGHT,
-    .display_pixel = PCD8544_DISPLAY_PIXEL,
-    .font_width = PCD8544_FONT_WIDTH,
-    .font_height = PCD8544_FONT_HEIGHT
-  }; 
-  // set frame buffer
-  uint8_t *buffer;
-  buffer = (uint8_t *)malloc(tg.display_pixel);
-  if (buffer != NULL) {
-    memset(buffer, 0, tg.display_pixel);
+  mrb_value names = mrb_ary_new(mrb);
+  for (int16_t i = 0; fonts[i] != NULL; i++) {
+    mrb_ary_push(mrb, names, mrb_str_new_cstr(mrb, fonts[i]->name));
   }
-  tg.display_buffer = buffer; 
+  return names;
+}
 
-  spicfg->tinygrafx = tg;
+// Get and set the text font size
+static mrb_value
+lcd_get_fontsize(mrb_state *mrb, mrb_value self)
+{
+  draw_state_t *tg = draw_state(mrb, self);
+  return mrb_fixnum_value(tg->fontsize);
 }
 
-// free mrb object for GC.
-static void
-meb_pcd8544_free(mrb_state *mrb, void *ptr)
+static mrb_value
+lcd_set_fontsize(mrb_state *mrb, mrb_value self)
 {
-  spi_config_t *spicfg = ptr;
-  mrb_free(mrb, spicfg->tinygrafx.display_buffer);
-  mrb_free(mrb, spicfg->spi);
+  mrb_int fontsize;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "i", &fontsize);
+  if (fontsize < 1) {
+    fontsize = 1;
+  }
+  tg->fontsize = fontsize;
+  return mrb_fixnum_value(fontsize);
 }
 
-// mruby data_type
-static const struct mrb_data_type mrb_spi_config_type = {
-  "spi_config_type", meb_pcd8544_free
-};
+// mruby binding of scroll the clip rectangle, the vacated area is filled
+// with color (default BLACK)
+static mrb_value
+lcd_scroll(mrb_state *mrb, mrb_value self)
+{
+  mrb_int dx, dy;
+  mrb_int color = BLACK;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "ii|i", &dx, &dy, &color);
+
+  tg->draw_calls[STAT_SCROLL]++;
+  scroll(&tg->tinygrafx, dx, dy, color);
+  return mrb_nil_value();
+}
 
-// Initialize the SPI device for pcd8544
 static mrb_value
-pcd8544_spi_init(mrb_state *mrb, mrb_value self)
+lcd_scroll_region(mrb_state *mrb, mrb_value self)
 {
-  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
-  if (spicfg) {
-    mrb_free(mrb, spicfg);
-  }
-  DATA_PTR(self) = NULL;
+  mrb_int x, y, w, h, dx, dy;
+  mrb_int color = BLACK;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "iiiiii|i", &x, &y, &w, &h, &dx, &dy, &color);
 
-  // Get config param
-  mrb_int cs, dc, rst, mosi, sck, miso, freq, spi_mode, dma_ch;
-  mrb_get_args(mrb, "iiiiiiiii", &cs, &dc, &rst, &mosi, &sck, &miso, &freq, &spi_mode, &dma_ch);
+  tg->draw_calls[STAT_SCROLL]++;
+  scroll_region(&tg->tinygrafx, x, y, w, h, dx, dy, color);
+  return mrb_nil_value();
+}
 
-  // pcd8544 SPI bus config
-  spicfg = (spi_config_t *)mrb_malloc(mrb, sizeof(spi_config_t));
-  spicfg->num_cs   = cs;
-  spicfg->num_dc   = dc;
-  spicfg->num_rst  = rst;
-  spicfg->num_mosi = mosi;
-  spicfg->num_sck  = sck;
-  spicfg->num_miso = miso;
-  spicfg->spi_freq = freq;
-  spicfg->spi_mode = spi_mode;
-  spicfg->dma_ch   = dma_ch;
-  DATA_TYPE(self) = &mrb_spi_config_type;
-  DATA_PTR(self)  = spicfg;
+// Set the clip rectangle, in display coordinates
+static mrb_value
+lcd_set_clip(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y, w, h;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "iiii", &x, &y, &w, &h);
 
-  // Initialize the SPI
-  spi_bus_init(spicfg);
-  
-  // Initialize the pcd8544
-  pcd8544_init(spicfg);
-  
-  // Initialize the TINYGRAFX
-  tinygrafx_init(spicfg);
-  
+  set_clip(&tg->tinygrafx, x, y, w, h);
   return self;
 }
 
+static mrb_value
+lcd_reset_clip(mrb_state *mrb, mrb_value self)
+{
+  draw_state_t *tg = draw_state(mrb, self);
 
-// // Object duplication method
-// static mrb_value
-// spi_init_copy(mrb_state *mrb, mrb_value copy)
-// {
-//   mrb_value src;
-//   mrb_get_args(mrb, "o", &src);
-//   if (mrb_obj_equal(mrb, copy, src)) return copy;
-//   if (!mrb_obj_is_instance_of(mrb, src, mrb_obj_class(mrb, copy))) {
-//     mrb_raise(mrb, E_TYPE_ERROR, "wrong argument class");
-//   }
-//   if (!DATA_PTR(copy)) {
-//     DATA_PTR(copy) = (spi_config_t *)mrb_malloc(mrb, sizeof(spi_config_t));
-//     DATA_TYPE(copy) = &mrb_spi_config_type;
-//   }
-//   *(spi_config_t *)DATA_PTR(copy) = *(spi_config_t *)DATA_PTR(src);
-//   return copy;
-// }
+  reset_clip(&tg->tinygrafx);
+  return self;
+}
 
-// View config setting
+// Set the drawing origin, added to the coordinates of every primitive
 static mrb_value
-spi_view_config(mrb_state *mrb, mrb_value self)
+lcd_set_origin(mrb_state *mrb, mrb_value self)
 {
-  spi_config_t *spicfg = DATA_PTR(self);
-  mrb_value spi_param = mrb_ary_new_capa(mrb, 9);
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_cs));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_dc));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_rst));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_mosi));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_sck));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_miso));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->spi_freq));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->spi_mode));
-  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->dma_ch));
-  return spi_param;
+  mrb_int x, y;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "ii", &x, &y);
+
+  set_origin(&tg->tinygrafx, x, y);
+  return self;
 }
 
-// Set contrast
+// Batch command list reader.
+// The list is an Array of Integer (and String for CMD_TEXT), or a String
+// of packed 16 bit little-endian integers, e.g. Array#pack("s<*").
+typedef struct batch_list_t {
+  mrb_value list;
+  bool packed;
+  mrb_int pos;
+  mrb_int len;
+} batch_list_t;
+
 static mrb_value
-pcd8544_contrast(mrb_state *mrb, mrb_value self)
+batch_next(mrb_state *mrb, batch_list_t *cmds)
 {
-  mrb_int contrast;
-  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
-  mrb_get_args(mrb, "i", &contrast);
-  contrast = (contrast > 0x7F) ? 0x7F : contrast; // Range of contrast values (0-127)
-  uint8_t pcd8544_contrast_cmds[] = {
-    (PCD8544_FUNCTIONSET|PCD8544_EXTINSTRUCTION),
-    (PCD8544_SETVOP|contrast)
-  };
-  send_data(spicfg, pcd8544_contrast_cmds, sizeof(pcd8544_contrast_cmds), DC_CMD);
-  return mrb_nil_value();
+  if (cmds->pos >= cmds->len) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "batch: command list is truncated");
+  }
+  if (cmds->packed) {
+    uint8_t *p = (uint8_t *)RSTRING_PTR(cmds->list) + cmds->pos * 2;
+    cmds->pos++;
+    return mrb_fixnum_value((int16_t)(p[0] | (p[1] << 8)));
+  }
+  return mrb_ary_ref(mrb, cmds->list, cmds->pos++);
+}
+
+static int16_t
+batch_int(mrb_state *mrb, batch_list_t *cmds)
+{
+  mrb_value v = batch_next(mrb, cmds);
+  if (!mrb_fixnum_p(v)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "batch: expected Integer");
+  }
+  return mrb_fixnum(v);
 }
 
+// mruby binding of draw a list of commands in one call
+static mrb_value
+lcd_batch(mrb_state *mrb, mrb_value self)
+{
+  batch_list_t cmds;
+  int16_t a[2 * TINYGRAFX_POLYGON_MAX];
+  mrb_int count = 0;
+  draw_state_t *tg = draw_state(mrb, self);
+  mrb_get_args(mrb, "o", &cmds.list);
+
+  if (mrb_string_p(cmds.list)) {
+    cmds.packed = true;
+    cmds.len = RSTRING_LEN(cmds.list) / 2;
+  } else if (mrb_array_p(cmds.list)) {
+    cmds.packed = false;
+    cmds.len = RARRAY_LEN(cmds.list);
+  } else {
+    mrb_raise(mrb, E_TYPE_ERROR, "batch: expected Array or String");
+  }
+  cmds.pos = 0;
+
+  while (cmds.pos < cmds.len) {
+    int16_t cmd = batch_int(mrb, &cmds);
+    switch (cmd) {
+      case CMD_CLEAR:
+        buffer_clear(&tg->tinygrafx);
+        break;
+      case CMD_COLOR:
+        a[0] = batch_int(mrb, &cmds);
+        tg->color = ((a[0] < BLACK) || (a[0] > INVERT)) ? WHITE : a[0];
+        break;
+      case CMD_FONTSIZE:
+        a[0] = batch_int(mrb, &cmds);
+        tg->fontsize = (a[0] < 1) ? 1 : a[0];
+        break;
+      case CMD_PIXEL:
+        for (int i = 0; i < 2; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_PIXEL]++;
+        set_pixel(&tg->tinygrafx, a[0], a[1], tg->color);
+        break;
+      case CMD_LINE:
+        for (int i = 0; i < 4; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_LINE]++;
+        draw_line(&tg->tinygrafx, a[0], a[1], a[2], a[3], tg->color);
+        break;
+      case CMD_VLINE:
+        for (int i = 0; i < 3; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_VLINE]++;
+        draw_vertical_line(&tg->tinygrafx, a[0], a[1], a[2], tg->color);
+        break;
+      case CMD_HLINE:
+        for (int i = 0; i < 3; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_HLINE]++;
+        draw_horizontal_line(&tg->tinygrafx, a[0], a[1], a[2], tg->color);
+        break;
+      case CMD_RECT:
+        for (int i = 0; i < 4; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_RECT]++;
+        draw_rect(&tg->tinygrafx, a[0], a[1], a[2], a[3], tg->color);
+        break;
+      case CMD_FILL_RECT:
+        for (int i = 0; i < 4; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_RECT]++;
+        draw_fill_rect(&tg->tinygrafx, a[0], a[1], a[2], a[3], tg->color);
+        break;
+      case CMD_CIRCLE:
+        for (int i = 0; i < 3; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_CIRCLE]++;
+        draw_circle(&tg->tinygrafx, a[0], a[1], a[2], tg->color);
+        break;
+      case CMD_FILL_CIRCLE:
+        for (int i = 0; i < 3; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_CIRCLE]++;
+        draw_fill_circle(&tg->tinygrafx, a[0], a[1], a[2], tg->color);
+        break;
+      case CMD_TEXT: {
+        for (int i = 0; i < 2; i++) a[i] = batch_int(mrb, &cmds);
+        mrb_value text = batch_next(mrb, &cmds);
+        if (!mrb_string_p(text)) {
+          mrb_raise(mrb, E_TYPE_ERROR, "batch: expected String");
+        }
+        draw_text(tg, a[0], a[1], RSTRING_PTR(text), RSTRING_LEN(text));
+        break;
+      }
+      case CMD_FILL_TRIANGLE:
+        for (int i = 0; i < 6; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_TRIANGLE]++;
+        draw_fill_triangle(&tg->tinygrafx, a[0], a[1], a[2], a[3], a[4], a[5], tg->color);
+        break;
+      case CMD_FILL_ELLIPSE:
+        for (int i = 0; i < 4; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_ELLIPSE]++;
+        draw_fill_ellipse(&tg->tinygrafx, a[0], a[1], a[2], a[3], tg->color);
+        break;
+      case CMD_FILL_ROUND_RECT:
+        for (int i = 0; i < 5; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_ROUND_RECT]++;
+        draw_fill_round_rect(&tg->tinygrafx, a[0], a[1], a[2], a[3], a[4], tg->color);
+        break;
+      case CMD_FILL_POLYGON: {
+        int16_t n = batch_int(mrb, &cmds);
+        if ((n < 1) || (n > TINYGRAFX_POLYGON_MAX)) {
+          mrb_raise(mrb, E_ARGUMENT_ERROR, "batch: bad number of polygon points");
+        }
+        for (int i = 0; i < 2 * n; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_FILL_POLYGON]++;
+        draw_fill_polygon(&tg->tinygrafx, a, n, tg->color);
+        break;
+      }
+      case CMD_CLIP:
+        for (int i = 0; i < 4; i++) a[i] = batch_int(mrb, &cmds);
+        set_clip(&tg->tinygrafx, a[0], a[1], a[2], a[3]);
+        break;
+      case CMD_ORIGIN:
+        for (int i = 0; i < 2; i++) a[i] = batch_int(mrb, &cmds);
+        set_origin(&tg->tinygrafx, a[0], a[1]);
+        break;
+      case CMD_SCROLL:
+        for (int i = 0; i < 3; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_SCROLL]++;
+        scroll(&tg->tinygrafx, a[0], a[1], a[2]);
+        break;
+      case CMD_SCROLL_REGION:
+        for (int i = 0; i < 7; i++) a[i] = batch_int(mrb, &cmds);
+        tg->draw_calls[STAT_SCROLL]++;
+        scroll_region(&tg->tinygrafx, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+        break;
+      default:
+        mrb_raisef(mrb, E_ARGUMENT_ERROR, "batch: unknown command %S", mrb_fixnum_value(cmd));
+    }
+    count++;
+  }
+  return mrb_fixnum_value(count);
+}
+// ----- Common graphics methods -----
+
+
+
+
+// ----- Shared bus methods -----
+
+// free mrb object for GC. Panels still on the bus keep it open.
+static void
+mrb_bus_free(mrb_state *mrb, void *ptr)
+{
+  pcd8544_bus_release((pcd8544_bus_t *)ptr);
+}
+
+// mruby data_type
+static const struct mrb_data_type mrb_bus_type = {
+  "pcd8544_bus_type", mrb_bus_free
+};
+
+// Initialize the shared bus
+static mrb_value
+bus_init(mrb_state *mrb, mrb_value self)
+{
+  pcd8544_bus_t *bus = (pcd8544_bus_t *)DATA_PTR(self);
+  if (bus) {
+    mrb_bus_free(mrb, bus);
+  }
+  DATA_PTR(self) = NULL;
+
+  mrb_int mosi, sck, miso, dma_ch;
+  mrb_int transport = PCD8544_TRANSPORT;
+  mrb_get_args(mrb, "iiii|i", &mosi, &sck, &miso, &dma_ch, &transport);
+
+  bus = (pcd8544_bus_t *)calloc(1, sizeof(pcd8544_bus_t));
+  if (bus == NULL) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "PCD8544: cannot allocate the bus");
+  }
+  bus->num_mosi = mosi;
+  bus->num_sck  = sck;
+  bus->num_miso = miso;
+  bus->dma_ch   = dma_ch;
+
+  esp_err_t err = pcd8544_bus_open(bus, transport);
+  if (err != ESP_OK) {
+    pcd8544_bus_release(bus);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "PCD8544: transport is not supported");
+    }
+    mrb_raisef(mrb, E_RUNTIME_ERROR, "PCD8544: bus init error=%S", mrb_fixnum_value(err));
+  }
+  DATA_TYPE(self) = &mrb_bus_type;
+  DATA_PTR(self)  = bus;
+  return self;
+}
+
+// display the frames of all panels on the bus
+static mrb_value
+bus_display(mrb_state *mrb, mrb_value self)
+{
+  pcd8544_bus_t *bus = (pcd8544_bus_t *)DATA_PTR(self);
+  pcd8544_bus_display(bus);
+  return mrb_nil_value();
+}
+
+// latency of the last frame of each panel [us]
+static mrb_value
+bus_latency(mrb_state *mrb, mrb_value self)
+{
+  pcd8544_bus_t *bus = (pcd8544_bus_t *)DATA_PTR(self);
+  mrb_value latency = mrb_ary_new_capa(mrb, PCD8544_BUS_MAX_PANELS);
+  for (int i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+    spi_config_t *panel = bus->slots[i].panel;
+    if (panel != NULL) {
+      mrb_ary_push(mrb, latency, mrb_fixnum_value(panel->stats.latency_us));
+    }
+  }
+  return latency;
+}
+// ----- Shared bus methods -----
+
+
+
+
+// ----- PCD8544 methods and functions -----
+
+// display the frame buffer
+static mrb_value
+pcd8544_spi_display(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_send_display(spicfg);
+  pcd8544_wait(spicfg);
+  return mrb_nil_value();
+}
+
+// display the frame buffer without waiting for the transmission
+static mrb_value
+pcd8544_spi_display_async(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_send_display(spicfg);
+  return mrb_nil_value();
+}
+
+// wait for the transmission of the frame
+static mrb_value
+pcd8544_spi_wait(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_wait(spicfg);
+  return mrb_nil_value();
+}
+
+// true while the frame is being transmitted
+static mrb_value
+pcd8544_spi_busy(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  return mrb_bool_value(pcd8544_busy(spicfg));
+}
+
+// start the refresh task, send the newest frame "rate" times per second
+static mrb_value
+pcd8544_spi_refresh_start(mrb_state *mrb, mrb_value self)
+{
+  mrb_int rate = 30;
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  mrb_get_args(mrb, "|i", &rate);
+
+  if ((rate < 1) || (rate > PCD8544_REFRESH_MAX_RATE)) {
+    mrb_raisef(mrb, E_ARGUMENT_ERROR, "refresh_start: rate must be 1..%S", mrb_fixnum_value(PCD8544_REFRESH_MAX_RATE));
+  }
+  esp_err_t err = pcd8544_refresh_start(spicfg, rate);
+  if (err == ESP_ERR_INVALID_STATE) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "refresh_start: refresh task is already running");
+  } else if (err == ESP_ERR_NOT_SUPPORTED) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "refresh_start: not supported for a panel on a shared bus");
+  } else if (err != ESP_OK) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "refresh_start: cannot start the refresh task");
+  }
+  return mrb_nil_value();
+}
+
+// stop the refresh task
+static mrb_value
+pcd8544_spi_refresh_stop(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_refresh_stop(spicfg);
+  return mrb_nil_value();
+}
+
+// true while the refresh task is running
+static mrb_value
+pcd8544_spi_refresh_p(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  return mrb_bool_value(spicfg->refresh != NULL);
+}
+
+// clear the frame buffer and the gray overlays
+static mrb_value
+pcd8544_spi_clear(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  buffer_clear(&spicfg->draw.tinygrafx);
+  pcd8544_refresh_gray_clear(spicfg);
+  return self;
+}
+
+// gray levels shown by the refresh task, 2 to 4 (temporal grayscale)
+static mrb_value
+pcd8544_spi_set_gray_levels(mrb_state *mrb, mrb_value self)
+{
+  mrb_int levels;
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  mrb_get_args(mrb, "i", &levels);
+
+  if ((levels < 2) || (levels > PCD8544_GRAY_PLANES_MAX + 1)) {
+    mrb_raisef(mrb, E_ARGUMENT_ERROR, "gray_levels: 2..%S levels", mrb_fixnum_value(PCD8544_GRAY_PLANES_MAX + 1));
+  }
+  esp_err_t err = pcd8544_refresh_gray(spicfg, levels - 1);
+  if (err == ESP_ERR_INVALID_STATE) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "gray_levels: refresh task is not running");
+  } else if (err != ESP_OK) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "gray_levels: cannot allocate the bit planes");
+  }
+  return mrb_fixnum_value(levels);
+}
+
+static mrb_value
+pcd8544_spi_get_gray_levels(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  tinygrafx_t planes[PCD8544_GRAY_PLANES_MAX];
+  return mrb_fixnum_value(pcd8544_refresh_planes(spicfg, planes) + 1);
+}
+
+// draw an 8-bit grayscale image String in the gray levels, ordered
+// dithering without temporal grayscale
+static mrb_value
+pcd8544_spi_gray_image(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y, w, h;
+  mrb_value gray;
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  tinygrafx_t planes[PCD8544_GRAY_PLANES_MAX];
+  mrb_get_args(mrb, "iiiiS", &x, &y, &w, &h, &gray);
+
+  check_gray_image(mrb, w, h, gray);
+  int16_t count = pcd8544_refresh_planes(spicfg, planes);
+  spicfg->draw.draw_calls[STAT_DITHER]++;
+  dither_gray(planes, count, x, y, (const uint8_t *)RSTRING_PTR(gray), w, h);
+  return mrb_nil_value();
+}
+
+// free mrb object for GC.
+static void
+meb_pcd8544_free(mrb_state *mrb, void *ptr)
+{
+  spi_config_t *spicfg = ptr;
+  pcd8544_close(spicfg);
+  mrb_free(mrb, spicfg);
+}
+
+// mruby data_type
+static const struct mrb_data_type mrb_spi_config_type = {
+  "spi_config_type", meb_pcd8544_free
+};
+
+// Initialize the SPI device for pcd8544
+static mrb_value
+pcd8544_spi_init(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  if (spicfg) {
+    meb_pcd8544_free(mrb, spicfg);
+  }
+  DATA_PTR(self) = NULL;
+
+  // Get config param
+  mrb_int cs, dc, rst, mosi, sck, miso, freq, spi_mode, dma_ch;
+  mrb_int transport = PCD8544_TRANSPORT;
+  mrb_value bus = mrb_nil_value();
+  mrb_int driver = DRIVER_PCD8544;
+  mrb_get_args(mrb, "iiiiiiiii|ioi", &cs, &dc, &rst, &mosi, &sck, &miso, &freq, &spi_mode, &dma_ch, &transport, &bus, &driver);
+  if (display_driver(driver) == NULL) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "PCD8544: driver is not supported");
+  }
+
+  // pcd8544 SPI bus config
+  spicfg = (spi_config_t *)mrb_malloc(mrb, sizeof(spi_config_t));
+  spicfg->num_cs   = cs;
+  spicfg->num_dc   = dc;
+  spicfg->num_rst  = rst;
+  spicfg->num_mosi = mosi;
+  spicfg->num_sck  = sck;
+  spicfg->num_miso = miso;
+  spicfg->spi_freq = freq;
+  spicfg->spi_mode = spi_mode;
+  spicfg->dma_ch   = dma_ch;
+  spicfg->draw.color    = WHITE;
+  spicfg->draw.fontsize = 1;
+  spicfg->flush_mode = FLUSH_FULL;
+  spicfg->transport = NULL;
+  spicfg->bus = NULL;
+  if (!mrb_nil_p(bus)) {
+    // panel on a shared bus, the bus object keeps the SPI host
+    spicfg->bus = (pcd8544_bus_t *)mrb_data_get_ptr(mrb, bus, &mrb_bus_type);
+    if (spicfg->bus == NULL) {
+      mrb_free(mrb, spicfg);
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "PCD8544: bus must be an initialized LCD::Bus");
+    }
+  }
+  DATA_TYPE(self) = &mrb_spi_config_type;
+  DATA_PTR(self)  = spicfg;
+
+  // Initialize the transport, controller and TINYGRAFX
+  esp_err_t err = pcd8544_open(spicfg, driver, transport);
+  if (err == ESP_ERR_NO_MEM) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "PCD8544: cannot allocate frame buffers");
+  } else if (err == ESP_ERR_NOT_SUPPORTED) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "PCD8544: transport is not supported");
+  } else if ((err == ESP_ERR_INVALID_STATE) && (spicfg->transport == NULL)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "PCD8544: too many panels on the bus");
+  } else if (err != ESP_OK) {
+    mrb_raisef(mrb, E_RUNTIME_ERROR, "PCD8544: transport init error=%S", mrb_fixnum_value(err));
+  }
+  
+  return self;
+}
+
+
+// // Object duplication method
+// static mrb_value
+// spi_init_copy(mrb_state *mrb, mrb_value copy)
+// {
+//   mrb_value src;
+//   mrb_get_args(mrb, "o", &src);
+//   if (mrb_obj_equal(mrb, copy, src)) return copy;
+//   if (!mrb_obj_is_instance_of(mrb, src, mrb_obj_class(mrb, copy))) {
+//     mrb_raise(mrb, E_TYPE_ERROR, "wrong argument class");
+//   }
+//   if (!DATA_PTR(copy)) {
+//     DATA_PTR(copy) = (spi_config_t *)mrb_malloc(mrb, sizeof(spi_config_t));
+//     DATA_TYPE(copy) = &mrb_spi_config_type;
+//   }
+//   *(spi_config_t *)DATA_PTR(copy) = *(spi_config_t *)DATA_PTR(src);
+//   return copy;
+// }
+
+// View config setting
+static mrb_value
+spi_view_config(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = DATA_PTR(self);
+  mrb_value spi_param = mrb_ary_new_capa(mrb, 9);
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_cs));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_dc));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_rst));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_mosi));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_sck));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->num_miso));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->spi_freq));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->spi_mode));
+  mrb_ary_push(mrb, spi_param, mrb_fixnum_value(spicfg->dma_ch));
+  return spi_param;
+}
+
+// Set contrast
+static mrb_value
+pcd8544_contrast(mrb_state *mrb, mrb_value self)
+{
+  mrb_int contrast;
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  mrb_get_args(mrb, "i", &contrast);
+  contrast = (contrast > 0x7F) ? 0x7F : contrast; // Range of contrast values (0-127)
+  pcd8544_set_contrast(spicfg, contrast);
+  return mrb_nil_value();
+}
+
+// Emulated DDRAM of the host transport, nil on the SPI transport
+static mrb_value
+pcd8544_ddram(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  const uint8_t *ddram = host_transport_ddram(spicfg);
+  if (ddram == NULL) {
+    return mrb_nil_value();
+  }
+  return mrb_str_new(mrb, (const char *)ddram, spicfg->draw.tinygrafx.display_pixel);
+}
+
+// Display size of the controller
+static mrb_value
+pcd8544_width(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  return mrb_fixnum_value(spicfg->draw.tinygrafx.display_width);
+}
+
+static mrb_value
+pcd8544_height(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  return mrb_fixnum_value(spicfg->draw.tinygrafx.display_height);
+}
+
+// Name of the controller driver
+static mrb_value
+pcd8544_driver_name(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  return mrb_str_new_cstr(mrb, spicfg->driver->name);
+}
+
+// Counter value, too large values for a fixnum are returned as a float
+static mrb_value
+stats_value(mrb_state *mrb, uint64_t value)
+{
+  if (value > MRB_INT_MAX) {
+    return mrb_float_value(mrb, (mrb_float)value);
+  }
+  return mrb_fixnum_value((mrb_int)value);
+}
+
+// Performance counters as a Hash
+static mrb_value
+pcd8544_stats(mrb_state *mrb, mrb_value self)
+{
+  static const char *draw_names[STAT_DRAW_MAX] = {
+    "pixel", "line", "vline", "hline", "rect", "fill_rect", "circle", "fill_circle", "text", "blit",
+    "fill_triangle", "fill_polygon", "fill_ellipse", "fill_round_rect", "scroll",
+    "rle", "dither"
+  };
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_stats_t *st = &spicfg->stats;
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_value draw_calls = mrb_hash_new(mrb);
+
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "frames")), stats_value(mrb, st->frames));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bytes")), stats_value(mrb, st->bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "transactions")), stats_value(mrb, st->transactions));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "send_us")), stats_value(mrb, st->send_us));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "wait_us")), stats_value(mrb, st->wait_us));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "spi_errors")), stats_value(mrb, st->spi_errors));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "timeouts")), stats_value(mrb, st->timeouts));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "latency_us")), stats_value(mrb, st->latency_us));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "max_latency_us")), stats_value(mrb, st->max_latency_us));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "skipped")), stats_value(mrb, st->skipped));
+  for (int i = 0; i < STAT_DRAW_MAX; i++) {
+    mrb_hash_set(mrb, draw_calls, mrb_symbol_value(mrb_intern_cstr(mrb, draw_names[i])), stats_value(mrb, st->draw_calls[i]));
+  }
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "draw_calls")), draw_calls);
+  return hash;
+}
+
+// Clear the performance counters
+static mrb_value
+pcd8544_stats_reset(mrb_state *mrb, mrb_value self)
+{
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  pcd8544_reset_stats(spicfg);
+  return mrb_nil_value();
+}
+
+// Set flush mode, FLUSH_FULL or FLUSH_DIFF
+static mrb_value
+pcd8544_flush_mode(mrb_state *mrb, mrb_value self)
+{
+  mrb_int mode;
+  spi_config_t *spicfg = (spi_config_t *)DATA_PTR(self);
+  mrb_get_args(mrb, "i", &mode);
+  spicfg->flush_mode = (mode == FLUSH_DIFF) ? FLUSH_DIFF : FLUSH_FULL;
+  return mrb_nil_value();
+}
+
+
+// ----- Canvas methods -----
+
+// Initialize a canvas of w x h pixels
+static mrb_value
+canvas_init(mrb_state *mrb, mrb_value self)
+{
+  canvas_t *canvas = (canvas_t *)DATA_PTR(self);
+  if (canvas) {
+    mrb_canvas_free(mrb, canvas);
+  }
+  DATA_PTR(self) = NULL;
+
+  mrb_int w, h;
+  mrb_get_args(mrb, "ii", &w, &h);
+
+  // canvas_open takes 16-bit sizes, check them before they are truncated
+  if ((w <= 0) || (w > TINYGRAFX_MAX_WIDTH) || (h <= 0) || (h > INT16_MAX)) {
+    mrb_raisef(mrb, E_ARGUMENT_ERROR, "Canvas: bad size, 1 to %S pixels wide", mrb_fixnum_value(TINYGRAFX_MAX_WIDTH));
+  }
+  canvas = (canvas_t *)mrb_malloc(mrb, sizeof(canvas_t));
+  esp_err_t err = canvas_open(canvas, w, h);
+  if (err != ESP_OK) {
+    mrb_free(mrb, canvas);
+    if (err == ESP_ERR_INVALID_ARG) {
+      mrb_raisef(mrb, E_ARGUMENT_ERROR, "Canvas: bad size, 1 to %S pixels wide", mrb_fixnum_value(TINYGRAFX_MAX_WIDTH));
+    }
+    mrb_raise(mrb, E_RUNTIME_ERROR, "Canvas: cannot allocate the frame buffer");
+  }
+  DATA_TYPE(self) = &mrb_canvas_type;
+  DATA_PTR(self)  = canvas;
+  return self;
+}
+
+static mrb_value
+canvas_width(mrb_state *mrb, mrb_value self)
+{
+  canvas_t *canvas = (canvas_t *)DATA_PTR(self);
+  return mrb_fixnum_value(canvas->draw.tinygrafx.display_width);
+}
+
+static mrb_value
+canvas_height(mrb_state *mrb, mrb_value self)
+{
+  canvas_t *canvas = (canvas_t *)DATA_PTR(self);
+  return mrb_fixnum_value(canvas->draw.tinygrafx.display_height);
+}
+
+// Frame buffer as a String in the page layout, usable with blit
+static mrb_value
+canvas_bitmap(mrb_state *mrb, mrb_value self)
+{
+  canvas_t *canvas = (canvas_t *)DATA_PTR(self);
+  tinygrafx_t *tg = &canvas->draw.tinygrafx;
+  return mrb_str_new(mrb, (const char *)tg->display_buffer, tg->display_pixel);
+}
+
+// Free bytes of the canvas pool as a Hash
+static mrb_value
+canvas_pool(mrb_state *mrb, mrb_value self)
+{
+  canvas_pool_stats_t st;
+  mrb_value hash = mrb_hash_new(mrb);
+
+  canvas_pool_stats(&st);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "size")), mrb_fixnum_value(CANVAS_POOL_SIZE));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "free")), mrb_fixnum_value(st.free));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "largest")), mrb_fixnum_value(st.largest));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "fallbacks")), mrb_fixnum_value(st.fallbacks));
+  return hash;
+}
+// ----- Canvas methods -----
+
+
+// ----- Console methods -----
+
+// Text console on a panel
+typedef struct mrb_console_t {
+  console_t console;
+  uint8_t banks;            // banks rendered but not sent yet
+} mrb_console_t;
+
+static void
+mrb_console_free(mrb_state *mrb, void *ptr)
+{
+  mrb_free(mrb, ptr);
+}
+
+static const struct mrb_data_type mrb_console_type = {
+  "LCD::Console", mrb_console_free
+};
+
+// Panel of the console
+static spi_config_t *
+console_panel(mrb_state *mrb, mrb_value self)
+{
+  mrb_value lcd = mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@lcd"));
+  return (spi_config_t *)mrb_data_get_ptr(mrb, lcd, &mrb_spi_config_type);
+}
+
+// Initialize a console covering the panel
+static mrb_value
+console_init(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  if (con) {
+    mrb_console_free(mrb, con);
+  }
+  DATA_PTR(self) = NULL;
+
+  mrb_value lcd;
+  mrb_get_args(mrb, "o", &lcd);
+  spi_config_t *spicfg = (spi_config_t *)mrb_data_get_ptr(mrb, lcd, &mrb_spi_config_type);
+  if (spicfg == NULL) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Console: expected an LCD::NOKIA5110");
+  }
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "@lcd"), lcd);
+
+  con = (mrb_console_t *)mrb_malloc(mrb, sizeof(mrb_console_t));
+  console_open(&con->console, &spicfg->draw.tinygrafx);
+  con->banks = 0;
+  DATA_TYPE(self) = &mrb_console_type;
+  DATA_PTR(self)  = con;
+  return self;
+}
+
+// Write the arguments as strings
+static void
+console_write_args(mrb_state *mrb, mrb_value self, bool newline)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  spi_config_t *spicfg = console_panel(mrb, self);
+  mrb_value *argv;
+  mrb_int argc;
+  mrb_get_args(mrb, "*", &argv, &argc);
+
+  for (mrb_int i = 0; i < argc; i++) {
+    mrb_value str = mrb_obj_as_string(mrb, argv[i]);
+    int16_t len = RSTRING_LEN(str);
+    console_write(&con->console, &spicfg->draw.tinygrafx, (const uint8_t *)RSTRING_PTR(str), len);
+    if (newline && ((len == 0) || (RSTRING_PTR(str)[len - 1] != '\n'))) {
+      console_write(&con->console, &spicfg->draw.tinygrafx, (const uint8_t *)"\n", 1);
+    }
+  }
+  if (newline && (argc == 0)) {
+    console_write(&con->console, &spicfg->draw.tinygrafx, (const uint8_t *)"\n", 1);
+  }
+}
+
+static mrb_value
+console_print(mrb_state *mrb, mrb_value self)
+{
+  console_write_args(mrb, self, false);
+  return mrb_nil_value();
+}
+
+static mrb_value
+console_puts(mrb_state *mrb, mrb_value self)
+{
+  console_write_args(mrb, self, true);
+  return mrb_nil_value();
+}
+
+// Move the cursor to the cell
+static mrb_value
+console_locate_cursor(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  mrb_int col, row;
+  mrb_get_args(mrb, "ii", &col, &row);
+
+  console_locate(&con->console, col, row);
+  return mrb_nil_value();
+}
+
+// Cursor as [col, row]
+static mrb_value
+console_cursor(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  mrb_value pos[2] = {
+    mrb_fixnum_value(con->console.col),
+    mrb_fixnum_value(con->console.row)
+  };
+  return mrb_ary_new_from_values(mrb, 2, pos);
+}
+
+static mrb_value
+console_cols(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  return mrb_fixnum_value(con->console.cols);
+}
+
+static mrb_value
+console_rows(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  return mrb_fixnum_value(con->console.rows);
+}
+
+static mrb_value
+console_clear_cells(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  console_clear(&con->console);
+  return mrb_nil_value();
+}
+
+// Draw the changed cells into the frame buffer of the panel
+static mrb_value
+console_render_cells(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  spi_config_t *spicfg = console_panel(mrb, self);
+
+  con->banks |= console_render(&con->console, &spicfg->draw.tinygrafx);
+  return mrb_nil_value();
+}
+
+// Draw the changed cells and send only their banks to the display.
+// Drawing outside the console is not sent, use the display of the panel.
+static mrb_value
+console_display(mrb_state *mrb, mrb_value self)
+{
+  mrb_console_t *con = (mrb_console_t *)DATA_PTR(self);
+  spi_config_t *spicfg = console_panel(mrb, self);
+
+  con->banks |= console_render(&con->console, &spicfg->draw.tinygrafx);
+  if (con->banks != 0) {
+    pcd8544_send_banks(spicfg, con->banks);
+    pcd8544_wait(spicfg);
+    con->banks = 0;
+  }
+  return mrb_nil_value();
+}
+// ----- Console methods -----
+
+
+// ----- Animation methods -----
+
+static void
+mrb_anim_free(mrb_state *mrb, void *ptr)
+{
+  mrb_free(mrb, ptr);
+}
+
+static const struct mrb_data_type mrb_anim_type = {
+  "LCD::Animation", mrb_anim_free
+};
+
+// The data String may have moved since the last call
+static anim_t *
+anim_data(mrb_state *mrb, mrb_value self)
+{
+  anim_t *anim = (anim_t *)DATA_PTR(self);
+  mrb_value data = mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "@data"));
+
+  if (!mrb_string_p(data) || (RSTRING_LEN(data) != anim->length)) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "Animation: the data was modified");
+  }
+  anim->data = (const uint8_t *)RSTRING_PTR(data);
+  return anim;
+}
+
+// Initialize an animation from its encoded data
+static mrb_value
+anim_init(mrb_state *mrb, mrb_value self)
+{
+  anim_t *anim = (anim_t *)DATA_PTR(self);
+  if (anim) {
+    mrb_anim_free(mrb, anim);
+  }
+  DATA_PTR(self) = NULL;
+
+  mrb_value data;
+  mrb_get_args(mrb, "S", &data);
+
+  // The frames are validated once, keep a frozen copy so the caller's
+  // String can't change them afterwards
+  data = mrb_str_dup(mrb, data);
+  MRB_SET_FROZEN_FLAG(mrb_basic_ptr(data));
+
+  anim = (anim_t *)mrb_malloc(mrb, sizeof(anim_t));
+  if (anim_open(anim, (const uint8_t *)RSTRING_PTR(data), RSTRING_LEN(data)) != ESP_OK) {
+    mrb_free(mrb, anim);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Animation: bad animation data");
+  }
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "@data"), data);
+  DATA_TYPE(self) = &mrb_anim_type;
+  DATA_PTR(self)  = anim;
+  return self;
+}
+
+static mrb_value
+anim_width(mrb_state *mrb, mrb_value self)
+{
+  anim_t *anim = (anim_t *)DATA_PTR(self);
+  return mrb_fixnum_value(anim->width);
+}
+
+static mrb_value
+anim_height(mrb_state *mrb, mrb_value self)
+{
+  anim_t *anim = (anim_t *)DATA_PTR(self);
+  return mrb_fixnum_value(anim->height);
+}
+
+static mrb_value
+anim_frames(mrb_state *mrb, mrb_value self)
+{
+  anim_t *anim = (anim_t *)DATA_PTR(self);
+  return mrb_fixnum_value(anim->frames);
+}
+
+// Play on a panel at (x, y), "fps" frames per second, "loops" times.
+// Returns the playback counters as a Hash.
+static mrb_value
+anim_play_frames(mrb_state *mrb, mrb_value self)
+{
+  mrb_value lcd;
+  mrb_int x = 0, y = 0, fps = 15, loops = 1;
+  anim_stats_t st;
+  mrb_get_args(mrb, "o|iiii", &lcd, &x, &y, &fps, &loops);
+
+  spi_config_t *spicfg = (spi_config_t *)mrb_data_get_ptr(mrb, lcd, &mrb_spi_config_type);
+  if (spicfg == NULL) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "play: expected an LCD::NOKIA5110");
+  }
+  if ((fps < 0) || (fps > 1000) || (loops < 1) || (loops > UINT16_MAX)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "play: fps must be 0..1000 and loops 1..65535");
+  }
+  anim_t *anim = anim_data(mrb, self);
+  if (anim_play(spicfg, anim, x, y, fps, loops, &st) != ESP_OK) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "play: bad frame data");
+  }
+
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "frames")), mrb_fixnum_value(st.frames));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "shown")), mrb_fixnum_value(st.shown));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "dropped")), mrb_fixnum_value(st.dropped));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bytes")), mrb_fixnum_value(st.bytes));
+  return hash;
+}
+
+// Encode an Array of bitmap Strings (w x h, page layout) as an animation
+static mrb_value
+anim_encode(mrb_state *mrb, mrb_value self)
+{
+  mrb_value list;
+  mrb_int w, h;
+  mrb_get_args(mrb, "Aii", &list, &w, &h);
+
+  mrb_int count = RARRAY_LEN(list);
+  if ((w <= 0) || (w > 255) || (h <= 0) || (h > 255)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "encode: bad size, 1 to 255 pixels");
+  }
+  if ((count < 1) || (count > UINT16_MAX)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "encode: 1 to 65535 frames");
+  }
+  for (mrb_int i = 0; i < count; i++) {
+    mrb_value bitmap = mrb_ary_ref(mrb, list, i);
+    if (!mrb_string_p(bitmap) || (RSTRING_LEN(bitmap) < w * ((h + 7) / 8))) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "bitmap is smaller than w * h");
+    }
+  }
+
+  uint8_t header[ANIM_HEADER_SIZE];
+  anim_encode_header(header, sizeof(header), w, h, count);
+  mrb_value out = mrb_str_new(mrb, (const char *)header, sizeof(header));
+  mrb_value frame = mrb_str_new_capa(mrb, ANIM_FRAME_MAX(w, h));
+  for (mrb_int i = 0; i < count; i++) {
+    mrb_value prev = (i > 0) ? mrb_ary_ref(mrb, list, i - 1) : mrb_nil_value();
+    mrb_value bitmap = mrb_ary_ref(mrb, list, i);
+    int32_t len = anim_encode_frame(mrb_nil_p(prev) ? NULL : (const uint8_t *)RSTRING_PTR(prev),
+                                    (const uint8_t *)RSTRING_PTR(bitmap), w, h,
+                                    (uint8_t *)RSTRING_PTR(frame), ANIM_FRAME_MAX(w, h));
+    if (len < 0) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "encode: cannot encode the frame");
+    }
+    mrb_str_cat(mrb, out, RSTRING_PTR(frame), len);
+  }
+  return out;
+}
+// ----- Animation methods -----
+
+
+// Common graphics methods of the panels and the canvases
+static void
+define_graphics_methods(mrb_state *mrb, struct RClass *cls)
+{
+  mrb_define_method(mrb, cls, "color", lcd_get_color, MRB_ARGS_NONE());
+  mrb_define_method(mrb, cls, "color=", lcd_set_color, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "fontsize", lcd_get_fontsize, MRB_ARGS_NONE());
+  mrb_define_method(mrb, cls, "fontsize=", lcd_set_fontsize, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "font", lcd_get_font, MRB_ARGS_NONE());
+  mrb_define_method(mrb, cls, "font=", lcd_set_font, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "text_width", lcd_text_width, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "clear", lcd_clear, MRB_ARGS_NONE());
+  mrb_define_method(mrb, cls, "set_pixel", lcd_set_pixel, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, cls, "get_pixel", lcd_get_pixel, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, cls, "line", lcd_draw_line, MRB_ARGS_REQ(4));
+  mrb_define_method(mrb, cls, "vline", lcd_draw_vertical_line, MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, cls, "hline", lcd_draw_horizontal_line, MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, cls, "rect", lcd_draw_rect, MRB_ARGS_REQ(4));
+  mrb_define_method(mrb, cls, "fill_rect", lcd_draw_fill_rect, MRB_ARGS_REQ(4));
+  mrb_define_method(mrb, cls, "circle", lcd_draw_circle, MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, cls, "fill_circle", lcd_draw_fill_circle, MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, cls, "fill_ellipse", lcd_draw_fill_ellipse, MRB_ARGS_REQ(4));
+  mrb_define_method(mrb, cls, "fill_round_rect", lcd_draw_fill_round_rect, MRB_ARGS_REQ(5));
+  mrb_define_method(mrb, cls, "fill_triangle", lcd_draw_fill_triangle, MRB_ARGS_REQ(6));
+  mrb_define_method(mrb, cls, "fill_polygon", lcd_draw_fill_polygon, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "text", lcd_text, MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, cls, "blit", lcd_blit, MRB_ARGS_ARG(5, 2));
+  mrb_define_method(mrb, cls, "draw_canvas", lcd_draw_canvas, MRB_ARGS_ARG(3, 1));
+  mrb_define_method(mrb, cls, "draw_rle", lcd_draw_rle, MRB_ARGS_ARG(2, 2) | MRB_ARGS_BLOCK());
+  mrb_define_method(mrb, cls, "dither", lcd_dither, MRB_ARGS_ARG(5, 1));
+  mrb_define_method(mrb, cls, "batch", lcd_batch, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, cls, "set_clip", lcd_set_clip, MRB_ARGS_REQ(4));
+  mrb_define_method(mrb, cls, "reset_clip", lcd_reset_clip, MRB_ARGS_NONE());
+  mrb_define_method(mrb, cls, "set_origin", lcd_set_origin, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, cls, "scroll", lcd_scroll, MRB_ARGS_ARG(2, 1));
+  mrb_define_method(mrb, cls, "scroll_region", lcd_scroll_region, MRB_ARGS_ARG(6, 1));
+}
 
 void
 mrb_mruby_esp32_nokia5110_gem_init(mrb_state* mrb)
@@ -583,33 +1707,112 @@ mrb_mruby_esp32_nokia5110_gem_init(mrb_state* mrb)
   mrb_define_const(mrb, lcd, "BLACK", mrb_fixnum_value(BLACK));
   mrb_define_const(mrb, lcd, "WHITE", mrb_fixnum_value(WHITE));
   mrb_define_const(mrb, lcd, "INVERT", mrb_fixnum_value(INVERT));
+  mrb_define_const(mrb, lcd, "BLIT_COPY", mrb_fixnum_value(BLIT_COPY));
+  mrb_define_const(mrb, lcd, "BLIT_OR", mrb_fixnum_value(BLIT_OR));
+  mrb_define_const(mrb, lcd, "BLIT_AND", mrb_fixnum_value(BLIT_AND));
+  mrb_define_const(mrb, lcd, "BLIT_XOR", mrb_fixnum_value(BLIT_XOR));
+  mrb_define_const(mrb, lcd, "BLIT_ERASE", mrb_fixnum_value(BLIT_ERASE));
+  mrb_define_const(mrb, lcd, "BLIT_MASKED", mrb_fixnum_value(BLIT_MASKED));
+  mrb_define_const(mrb, lcd, "DITHER_BAYER", mrb_fixnum_value(DITHER_BAYER));
+  mrb_define_const(mrb, lcd, "DITHER_DIFFUSION", mrb_fixnum_value(DITHER_DIFFUSION));
+  mrb_define_module_function(mrb, lcd, "fonts", lcd_fonts, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, lcd, "rle_encode", lcd_rle_encode, MRB_ARGS_REQ(3));
+  mrb_define_module_function(mrb, lcd, "rle_size", lcd_rle_size, MRB_ARGS_REQ(1));
+  mrb_define_const(mrb, lcd, "CMD_CLEAR", mrb_fixnum_value(CMD_CLEAR));
+  mrb_define_const(mrb, lcd, "CMD_COLOR", mrb_fixnum_value(CMD_COLOR));
+  mrb_define_const(mrb, lcd, "CMD_FONTSIZE", mrb_fixnum_value(CMD_FONTSIZE));
+  mrb_define_const(mrb, lcd, "CMD_PIXEL", mrb_fixnum_value(CMD_PIXEL));
+  mrb_define_const(mrb, lcd, "CMD_LINE", mrb_fixnum_value(CMD_LINE));
+  mrb_define_const(mrb, lcd, "CMD_VLINE", mrb_fixnum_value(CMD_VLINE));
+  mrb_define_const(mrb, lcd, "CMD_HLINE", mrb_fixnum_value(CMD_HLINE));
+  mrb_define_const(mrb, lcd, "CMD_RECT", mrb_fixnum_value(CMD_RECT));
+  mrb_define_const(mrb, lcd, "CMD_FILL_RECT", mrb_fixnum_value(CMD_FILL_RECT));
+  mrb_define_const(mrb, lcd, "CMD_CIRCLE", mrb_fixnum_value(CMD_CIRCLE));
+  mrb_define_const(mrb, lcd, "CMD_FILL_CIRCLE", mrb_fixnum_value(CMD_FILL_CIRCLE));
+  mrb_define_const(mrb, lcd, "CMD_TEXT", mrb_fixnum_value(CMD_TEXT));
+  mrb_define_const(mrb, lcd, "CMD_FILL_TRIANGLE", mrb_fixnum_value(CMD_FILL_TRIANGLE));
+  mrb_define_const(mrb, lcd, "CMD_FILL_ELLIPSE", mrb_fixnum_value(CMD_FILL_ELLIPSE));
+  mrb_define_const(mrb, lcd, "CMD_FILL_ROUND_RECT", mrb_fixnum_value(CMD_FILL_ROUND_RECT));
+  mrb_define_const(mrb, lcd, "CMD_FILL_POLYGON", mrb_fixnum_value(CMD_FILL_POLYGON));
+  mrb_define_const(mrb, lcd, "CMD_CLIP", mrb_fixnum_value(CMD_CLIP));
+  mrb_define_const(mrb, lcd, "CMD_ORIGIN", mrb_fixnum_value(CMD_ORIGIN));
+  mrb_define_const(mrb, lcd, "CMD_SCROLL", mrb_fixnum_value(CMD_SCROLL));
+  mrb_define_const(mrb, lcd, "CMD_SCROLL_REGION", mrb_fixnum_value(CMD_SCROLL_REGION));
 
   struct RClass *pcd8544 = mrb_define_class_under(mrb, lcd, "NOKIA5110", mrb->object_class);
   MRB_SET_INSTANCE_TT(pcd8544, MRB_TT_DATA);
 
   // Common graphics methods
-  mrb_define_method(mrb, pcd8544, "clear", lcd_clear, MRB_ARGS_NONE());
-  mrb_define_method(mrb, pcd8544, "set_pixel", lcd_set_pixel, MRB_ARGS_REQ(2));
-  mrb_define_method(mrb, pcd8544, "get_pixel", lcd_get_pixel, MRB_ARGS_REQ(2));
-  mrb_define_method(mrb, pcd8544, "line", lcd_draw_line, MRB_ARGS_REQ(4));
-  mrb_define_method(mrb, pcd8544, "vline", lcd_draw_vertical_line, MRB_ARGS_REQ(3));
-  mrb_define_method(mrb, pcd8544, "hline", lcd_draw_horizontal_line, MRB_ARGS_REQ(3));
-  mrb_define_method(mrb, pcd8544, "rect", lcd_draw_rect, MRB_ARGS_REQ(4));
-  mrb_define_method(mrb, pcd8544, "fill_rect", lcd_draw_fill_rect, MRB_ARGS_REQ(4));
-  mrb_define_method(mrb, pcd8544, "circle", lcd_draw_circle, MRB_ARGS_REQ(3));
-  mrb_define_method(mrb, pcd8544, "fill_circle", lcd_draw_fill_circle, MRB_ARGS_REQ(3));
-  mrb_define_method(mrb, pcd8544, "text", lcd_text, MRB_ARGS_REQ(3));
+  define_graphics_methods(mrb, pcd8544);
 
   // Send frame buffer to display
   mrb_define_method(mrb, pcd8544, "display", pcd8544_spi_display, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "display_async", pcd8544_spi_display_async, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "wait", pcd8544_spi_wait, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "busy?", pcd8544_spi_busy, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "refresh_start", pcd8544_spi_refresh_start, MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, pcd8544, "refresh_stop", pcd8544_spi_refresh_stop, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "refresh?", pcd8544_spi_refresh_p, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "clear", pcd8544_spi_clear, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "gray_levels", pcd8544_spi_get_gray_levels, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "gray_levels=", pcd8544_spi_set_gray_levels, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, pcd8544, "gray_image", pcd8544_spi_gray_image, MRB_ARGS_REQ(5));
 
   // pcd8544 spi method
   mrb_define_method(mrb, pcd8544, "_init", pcd8544_spi_init, MRB_ARGS_NONE());
   // mrb_define_method(mrb, pcd8544, "initialize_copy", spi_init_copy, MRB_ARGS_REQ(1));
   mrb_define_method(mrb, pcd8544, "config?", spi_view_config, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "ddram", pcd8544_ddram, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "width", pcd8544_width, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "height", pcd8544_height, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "driver", pcd8544_driver_name, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "stats", pcd8544_stats, MRB_ARGS_NONE());
+  mrb_define_method(mrb, pcd8544, "reset_stats", pcd8544_stats_reset, MRB_ARGS_NONE());
 
   // pcd8544 control command
   mrb_define_method(mrb, pcd8544, "contrast=", pcd8544_contrast, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, pcd8544, "flush_mode=", pcd8544_flush_mode, MRB_ARGS_REQ(1));
+
+  // Shared bus of several panels
+  struct RClass *bus = mrb_define_class_under(mrb, lcd, "Bus", mrb->object_class);
+  MRB_SET_INSTANCE_TT(bus, MRB_TT_DATA);
+  mrb_define_method(mrb, bus, "_init", bus_init, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bus, "display", bus_display, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bus, "latency", bus_latency, MRB_ARGS_NONE());
+
+  // Off-screen canvas
+  struct RClass *canvas = mrb_define_class_under(mrb, lcd, "Canvas", mrb->object_class);
+  MRB_SET_INSTANCE_TT(canvas, MRB_TT_DATA);
+  define_graphics_methods(mrb, canvas);
+  mrb_define_method(mrb, canvas, "initialize", canvas_init, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, canvas, "width", canvas_width, MRB_ARGS_NONE());
+  mrb_define_method(mrb, canvas, "height", canvas_height, MRB_ARGS_NONE());
+  mrb_define_method(mrb, canvas, "bitmap", canvas_bitmap, MRB_ARGS_NONE());
+  mrb_define_class_method(mrb, canvas, "pool", canvas_pool, MRB_ARGS_NONE());
+
+  // Text console
+  struct RClass *console = mrb_define_class_under(mrb, lcd, "Console", mrb->object_class);
+  MRB_SET_INSTANCE_TT(console, MRB_TT_DATA);
+  mrb_define_method(mrb, console, "initialize", console_init, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, console, "print", console_print, MRB_ARGS_ANY());
+  mrb_define_method(mrb, console, "puts", console_puts, MRB_ARGS_ANY());
+  mrb_define_method(mrb, console, "locate", console_locate_cursor, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, console, "cursor", console_cursor, MRB_ARGS_NONE());
+  mrb_define_method(mrb, console, "cols", console_cols, MRB_ARGS_NONE());
+  mrb_define_method(mrb, console, "rows", console_rows, MRB_ARGS_NONE());
+  mrb_define_method(mrb, console, "clear", console_clear_cells, MRB_ARGS_NONE());
+  mrb_define_method(mrb, console, "render", console_render_cells, MRB_ARGS_NONE());
+  mrb_define_method(mrb, console, "display", console_display, MRB_ARGS_NONE());
+
+  // Delta frame animation
+  struct RClass *anim = mrb_define_class_under(mrb, lcd, "Animation", mrb->object_class);
+  MRB_SET_INSTANCE_TT(anim, MRB_TT_DATA);
+  mrb_define_method(mrb, anim, "initialize", anim_init, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, anim, "width", anim_width, MRB_ARGS_NONE());
+  mrb_define_method(mrb, anim, "height", anim_height, MRB_ARGS_NONE());
+  mrb_define_method(mrb, anim, "frames", anim_frames, MRB_ARGS_NONE());
+  mrb_define_method(mrb, anim, "play", anim_play_frames, MRB_ARGS_ARG(1, 4));
+  mrb_define_class_method(mrb, anim, "encode", anim_encode, MRB_ARGS_REQ(3));
 
   struct RClass *constants = mrb_define_module_under(mrb, pcd8544, "Constants");
   mrb_define_const(mrb, constants, "CS",        mrb_fixnum_value(PCD8544_PIN_NUM_CS));
@@ -624,6 +1827,13 @@ mrb_mruby_esp32_nokia5110_gem_init(mrb_state* mrb)
   mrb_define_const(mrb, constants, "NO_DMA",    mrb_fixnum_value(NO_DMA));
   mrb_define_const(mrb, constants, "DMA_CH1",   mrb_fixnum_value(DMA_CH1));
   mrb_define_const(mrb, constants, "DMA_CH2",   mrb_fixnum_value(DMA_CH2));
+  mrb_define_const(mrb, constants, "FLUSH_FULL", mrb_fixnum_value(FLUSH_FULL));
+  mrb_define_const(mrb, constants, "FLUSH_DIFF", mrb_fixnum_value(FLUSH_DIFF));
+  mrb_define_const(mrb, constants, "TRANSPORT", mrb_fixnum_value(PCD8544_TRANSPORT));
+  mrb_define_const(mrb, constants, "TRANSPORT_SPI", mrb_fixnum_value(TRANSPORT_SPI));
+  mrb_define_const(mrb, constants, "TRANSPORT_HOST", mrb_fixnum_value(TRANSPORT_HOST));
+  mrb_define_const(mrb, constants, "DRIVER_PCD8544", mrb_fixnum_value(DRIVER_PCD8544));
+  mrb_define_const(mrb, constants, "DRIVER_SSD1306", mrb_fixnum_value(DRIVER_SSD1306));
 }
 
 void
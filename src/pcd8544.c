@@ -0,0 +1,481 @@
+// PCD8544 protocol layer.
+// Builds the command/data byte stream of the flushes on the commands of the
+// controller driver (PCD8544 or SSD1306) and hands it to the transport
+// backend (ESP32 SPI or the in-memory host emulation).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcd8544.h"
+
+static const char *TAG = "PCD8544";
+
+// Send buffer data to the display. Returns once the data is queued,
+// call pcd8544_wait() to wait for the transmission.
+static inline void
+send_data(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  spicfg->stats.bytes += len;
+  if ((spicfg->bus != NULL) && spicfg->bus->recording) {
+    // the shared bus sends the frame later
+    pcd8544_bus_record(spicfg, data, len, dc);
+    return;
+  }
+
+  int64_t start = esp_timer_get_time();
+  spicfg->transport->send(spicfg, data, len, dc);
+  spicfg->stats.send_us += esp_timer_get_time() - start;
+}
+
+// write address config. use horizontal addressing mode.
+DRAM_ATTR static const uint8_t pcd8544_address_init[] = {
+  (PCD8544_FUNCTIONSET),                        // use basic instruction set
+  (PCD8544_DISPLAYCTRL|PCD8544_DISPLAYNORMAL),  // display config = normal mode
+  (PCD8544_SETXADDR),                           // set X address = 0
+  (PCD8544_SETYADDR)                            // set Y address = 0
+};
+
+// pcd8544 init commands
+DRAM_ATTR static const uint8_t pcd8544_init_cmds[] = {
+  (PCD8544_FUNCTIONSET|PCD8544_EXTINSTRUCTION), // use extended instruction set
+  (PCD8544_SETTEMP|0x00),                       // set temperature coefficient
+  (PCD8544_SETBIAS|0x03),                       // set bias system
+  (PCD8544_SETVOP|0x39)                         // set contrast
+};
+
+// Allocate a frame buffer that the transport can transmit directly
+static uint8_t *
+frame_buffer_alloc(spi_config_t *spicfg, int16_t size)
+{
+  uint8_t *buffer = spicfg->transport->alloc(spicfg, size);
+
+  if (buffer != NULL) {
+    memset(buffer, 0x00, size);
+  }
+  return buffer;
+}
+
+static void
+frame_buffer_free(spi_config_t *spicfg, uint8_t *buffer)
+{
+  if (buffer != NULL) {
+    spicfg->transport->free(spicfg, buffer);
+  }
+}
+
+// Send controller commands, up to 4 bytes are copied
+void
+pcd8544_send_cmds(spi_config_t *spicfg, const uint8_t *cmds, int16_t len)
+{
+  send_data(spicfg, cmds, len, DC_CMD);
+}
+
+// Set the RAM address. X is the column, bank is the 8 pixel row.
+// The data of a run ends at x1 and bank b1.
+static inline void
+pcd8544_set_address(spi_config_t *spicfg, int16_t x, int16_t bank, int16_t x1, int16_t b1, bool vertical)
+{
+  spicfg->driver->address(spicfg, x, bank, x1, b1, vertical);
+}
+
+// Send the whole frame
+static void
+pcd8544_send_full(spi_config_t *spicfg, const uint8_t *frame)
+{
+  send_data(spicfg, spicfg->driver->frame_cmds, spicfg->driver->frame_len, DC_CMD);
+  send_data(spicfg, frame, spicfg->draw.tinygrafx.display_pixel, DC_DATA);
+}
+
+// Send the banks of the frame set in "banks", consecutive banks as one run
+static void
+pcd8544_send_bank_runs(spi_config_t *spicfg, const uint8_t *frame, uint8_t banks)
+{
+  tinygrafx_t tg = spicfg->draw.tinygrafx;
+  int16_t count = tg.display_height / 8;
+
+  for (int16_t bank = 0; bank < count; bank++) {
+    if ((banks & (1 << bank)) == 0) continue;
+
+    int16_t start = bank;
+    while ((bank + 1 < count) && (banks & (1 << (bank + 1)))) {
+      bank++;
+    }
+    pcd8544_set_address(spicfg, 0, start, tg.display_width - 1, bank, false);
+    send_data(spicfg, frame + start * tg.display_width, (bank - start + 1) * tg.display_width, DC_DATA);
+  }
+}
+
+// Walk the changed runs of the banks set in "banks", comparing the frame with the frame
+// shown on the display. Runs separated by fewer unchanged bytes than the cost
+// of re-addressing are merged. Send the runs if "send" is true.
+// Returns the cost of the runs in bytes.
+static int16_t
+pcd8544_diff_runs(spi_config_t *spicfg, const uint8_t *frame, const uint8_t *shown, uint8_t banks, bool send)
+{
+  tinygrafx_t tg = spicfg->draw.tinygrafx;
+  int16_t count = tg.display_height / 8;
+  int16_t run_cost = spicfg->driver->run_cost;
+  int16_t cost = 0;
+
+  for (int16_t bank = 0; bank < count; bank++) {
+    if ((banks & (1 << bank)) == 0) continue;
+
+    const uint8_t *cur = frame + bank * tg.display_width;
+    const uint8_t *old = shown + bank * tg.display_width;
+    int16_t x = 0;
+
+    while (x < tg.display_width) {
+      if (cur[x] == old[x]) {
+        x++;
+        continue;
+      }
+      int16_t start = x;
+      int16_t end = x;
+      for (x = start + 1; (x < tg.display_width) && (x - end <= run_cost); x++) {
+        if (cur[x] != old[x]) {
+          end = x;
+        }
+      }
+      int16_t len = end - start + 1;
+      cost += len + run_cost;
+      if (send) {
+        pcd8544_set_address(spicfg, start, bank, end, bank, false);
+        send_data(spicfg, cur + start, len, DC_DATA);
+      }
+    }
+  }
+  return cost;
+}
+
+// Send only the changed bytes of the banks set in "banks".
+// Use vertical addressing mode when a narrow column strip changed.
+static void
+pcd8544_send_diff(spi_config_t *spicfg, const uint8_t *frame, const uint8_t *shown, uint8_t banks)
+{
+  tinygrafx_t tg = spicfg->draw.tinygrafx;
+  int16_t count = tg.display_height / 8;
+  int16_t x0 = tg.display_width, x1 = -1, b0 = count, b1 = -1;
+
+  // bounding box of the changed bytes
+  for (int16_t bank = 0; bank < count; bank++) {
+    if ((banks & (1 << bank)) == 0) continue;
+    for (int16_t x = 0; x < tg.display_width; x++) {
+      int16_t i = x + bank * tg.display_width;
+      if (frame[i] != shown[i]) {
+        if (x < x0) x0 = x;
+        if (x > x1) x1 = x;
+        if (bank < b0) b0 = bank;
+        b1 = bank;
+      }
+    }
+  }
+  if (x1 < 0) return;
+
+  // In vertical addressing mode the Y address wraps to the next column,
+  // so without an address window a strip wider than one column has to cover
+  // every bank. The strip may only cover banks that are sent.
+  if ((x1 > x0) && !spicfg->driver->window) {
+    b0 = 0;
+    b1 = count - 1;
+  }
+  int16_t strip_len = (x1 - x0 + 1) * (b1 - b0 + 1);
+  uint8_t strip_banks = ((1 << (b1 + 1)) - 1) & ~((1 << b0) - 1);
+  bool strip = ((strip_banks & ~banks) == 0) &&
+    (strip_len + spicfg->driver->run_cost < pcd8544_diff_runs(spicfg, frame, shown, banks, false));
+
+  if (strip) {
+    uint8_t *buffer = spicfg->strip_buffer;
+    int16_t n = 0;
+    for (int16_t x = x0; x <= x1; x++) {
+      for (int16_t bank = b0; bank <= b1; bank++) {
+        buffer[n++] = frame[x + bank * tg.display_width];
+      }
+    }
+    pcd8544_set_address(spicfg, x0, b0, x1, b1, true);
+    send_data(spicfg, buffer, strip_len, DC_DATA);
+  } else {
+    pcd8544_diff_runs(spicfg, frame, shown, banks, true);
+  }
+}
+
+// Send a frame, the whole frame or only the bytes that differ from the
+// frame shown on the display. Returns once the frame is queued.
+// Only the banks set in "banks" are sent, the others are left as shown. The
+// whole frame is sent while the frame shown on the display is not known.
+void
+pcd8544_send_frame(spi_config_t *spicfg, const uint8_t *frame, const uint8_t *shown, uint8_t banks)
+{
+  uint8_t all = (1 << (spicfg->draw.tinygrafx.display_height / 8)) - 1;
+
+  spicfg->stats.frames++;
+  if (!spicfg->shown_valid) {
+    banks = all;
+  }
+  if ((spicfg->flush_mode == FLUSH_DIFF) && spicfg->shown_valid) {
+    pcd8544_send_diff(spicfg, frame, shown, banks);
+  } else if ((banks & all) == all) {
+    pcd8544_send_full(spicfg, frame);
+  } else {
+    pcd8544_send_bank_runs(spicfg, frame, banks);
+  }
+  spicfg->shown_valid = true;
+}
+
+// Send buffer to display, returns once the frame is queued.
+// Swap the back (drawing) buffer and the front buffer, then send the front
+// buffer. The back buffer keeps the previous frame until the diff is done,
+// then it is reloaded with the new frame to continue drawing on it.
+// With the refresh task running, the frame is handed over to the task.
+void
+pcd8544_send_display(spi_config_t *spicfg)
+{
+  pcd8544_send_banks(spicfg, PCD8544_BANKS_ALL);
+}
+
+// Send the banks set in "banks" to display, the caller knows that the
+// other banks didn't change. The refresh task always takes the whole frame.
+void
+pcd8544_send_banks(spi_config_t *spicfg, uint8_t banks)
+{
+  if (spicfg->refresh != NULL) {
+    pcd8544_refresh_present(spicfg);
+    return;
+  }
+
+  tinygrafx_t tg = spicfg->draw.tinygrafx;
+  uint8_t *frame = tg.display_buffer;
+  uint8_t *shown = spicfg->front_buffer;
+
+  // the previous frame must be sent before reusing its buffer
+  pcd8544_wait(spicfg);
+  spicfg->front_buffer = frame;
+  spicfg->draw.tinygrafx.display_buffer = shown;
+
+  if (!spicfg->shown_valid) {
+    banks = PCD8544_BANKS_ALL;
+  }
+
+  // send buffer to pcd8544
+  pcd8544_send_frame(spicfg, frame, shown, banks);
+
+  // The front buffer keeps the frame shown on the display: a bank that was
+  // not sent swaps back, in case it was drawn on anyway.
+  for (int16_t bank = 0; bank < tg.display_height / 8; bank++) {
+    uint8_t *front = frame + bank * tg.display_width;
+    uint8_t *back = shown + bank * tg.display_width;
+
+    if (banks & (1 << bank)) {
+      memcpy(back, front, tg.display_width);
+    } else {
+      for (int16_t x = 0; x < tg.display_width; x++) {
+        uint8_t t = front[x];
+        front[x] = back[x];
+        back[x] = t;
+      }
+    }
+  }
+}
+
+// Wait for the transmission of the frame.
+// The refresh task owns the transport while it is running.
+void
+pcd8544_wait(spi_config_t *spicfg)
+{
+  if (spicfg->refresh != NULL) return;
+
+  spicfg->transport->wait(spicfg);
+}
+
+// true while the frame is being transmitted
+bool
+pcd8544_busy(spi_config_t *spicfg)
+{
+  if (spicfg->refresh != NULL) return false;
+
+  return spicfg->transport->busy(spicfg);
+}
+
+// Set contrast (0-127)
+void
+pcd8544_set_contrast(spi_config_t *spicfg, uint8_t contrast)
+{
+  if (spicfg->refresh != NULL) {
+    pcd8544_refresh_contrast(spicfg, contrast);
+    return;
+  }
+  pcd8544_wait(spicfg);
+  spicfg->driver->contrast(spicfg, contrast & 0x7F);
+  pcd8544_wait(spicfg);
+}
+
+// Clear the performance counters
+void
+pcd8544_reset_stats(spi_config_t *spicfg)
+{
+  memset(&spicfg->stats, 0, sizeof(pcd8544_stats_t));
+}
+
+// Transport backend of the TRANSPORT_* number, NULL if not supported
+const pcd8544_transport_t *
+pcd8544_transport(int16_t transport)
+{
+  switch (transport) {
+#ifdef ESP_PLATFORM
+    case TRANSPORT_SPI:  return &pcd8544_spi_transport;
+#endif
+    case TRANSPORT_HOST: return &pcd8544_host_transport;
+    default:             return NULL;
+  }
+}
+
+// Controller driver of the DRIVER_* number, NULL if not supported
+const display_driver_t *
+display_driver(int16_t driver)
+{
+  switch (driver) {
+    case DRIVER_PCD8544: return &pcd8544_driver;
+    case DRIVER_SSD1306: return &ssd1306_driver;
+    default:             return NULL;
+  }
+}
+
+// Configuration the Tiny graphics libraries
+// Allocate the frame buffers once, returns false if out of memory.
+static bool
+tinygrafx_init(spi_config_t *spicfg)
+{
+  tinygrafx_t tg = {
+    .display_width = spicfg->driver->width,
+    .display_height = spicfg->driver->height,
+    .display_pixel = spicfg->driver->width * spicfg->driver->height / 8,
+    .font_width = PCD8544_FONT_WIDTH,
+    .font_height = PCD8544_FONT_HEIGHT
+  };
+  reset_clip(&tg);
+  // set frame buffers, drawing into the back buffer.
+  tg.display_buffer = frame_buffer_alloc(spicfg, tg.display_pixel);
+  spicfg->draw.tinygrafx = tg;
+  spicfg->draw.font = NULL;
+  spicfg->front_buffer = frame_buffer_alloc(spicfg, tg.display_pixel);
+  spicfg->strip_buffer = frame_buffer_alloc(spicfg, tg.display_pixel);
+  spicfg->shown_valid = false;
+
+  return (tg.display_buffer != NULL) && (spicfg->front_buffer != NULL) && (spicfg->strip_buffer != NULL);
+}
+
+// Open the display on the transport backend, then initialize the
+// controller and the frame buffers. A panel on a shared bus (spicfg->bus)
+// uses the transport of the bus.
+esp_err_t
+pcd8544_open(spi_config_t *spicfg, int16_t driver, int16_t transport)
+{
+  esp_err_t err;
+
+  spicfg->draw.tinygrafx.display_buffer = NULL;
+  spicfg->front_buffer = NULL;
+  spicfg->strip_buffer = NULL;
+  spicfg->transport_data = NULL;
+  spicfg->bus_slot = NULL;
+  spicfg->refresh = NULL;
+  pcd8544_reset_stats(spicfg);
+  spicfg->draw.draw_calls = spicfg->stats.draw_calls;
+  spicfg->driver = display_driver(driver);
+  if (spicfg->driver == NULL) {
+    spicfg->transport = NULL;
+    spicfg->bus = NULL;
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (spicfg->bus != NULL) {
+    spicfg->transport = spicfg->bus->transport;
+    err = pcd8544_bus_attach(spicfg->bus, spicfg);
+    if (err != ESP_OK) {
+      spicfg->bus = NULL;
+      spicfg->transport = NULL;
+      return err;
+    }
+  } else {
+    spicfg->transport = pcd8544_transport(transport);
+    if (spicfg->transport == NULL) {
+      return ESP_ERR_NOT_SUPPORTED;
+    }
+  }
+
+  err = spicfg->transport->init(spicfg);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "pcd8544_open: %s transport init error=%d", spicfg->transport->name, err);
+    return err;
+  }
+
+  // Reset the display if host not in use
+  if (spicfg->require_reset) {
+    spicfg->transport->reset(spicfg);
+  }
+
+  // Send all commands
+  send_data(spicfg, spicfg->driver->init_cmds, spicfg->driver->init_len, DC_CMD);
+  pcd8544_wait(spicfg);
+
+  // Initialize the TINYGRAFX
+  if (!tinygrafx_init(spicfg)) {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+// Release the frame buffers and the transport
+void
+pcd8544_close(spi_config_t *spicfg)
+{
+  if (spicfg->transport == NULL) return;
+
+  pcd8544_refresh_stop(spicfg);
+  pcd8544_wait(spicfg);
+  frame_buffer_free(spicfg, spicfg->draw.tinygrafx.display_buffer);
+  frame_buffer_free(spicfg, spicfg->front_buffer);
+  frame_buffer_free(spicfg, spicfg->strip_buffer);
+  spicfg->draw.tinygrafx.display_buffer = NULL;
+  spicfg->front_buffer = NULL;
+  spicfg->strip_buffer = NULL;
+  spicfg->transport->deinit(spicfg);
+  spicfg->transport = NULL;
+  pcd8544_bus_detach(spicfg);
+}
+
+// PCD8544 driver.
+// Without an address window: the address wraps to the next bank, or to the
+// next column in vertical addressing mode.
+static void
+pcd8544_address(spi_config_t *spicfg, int16_t x0, int16_t b0, int16_t x1, int16_t b1, bool vertical)
+{
+  uint8_t cmds[] = {
+    (PCD8544_FUNCTIONSET|(vertical ? PCD8544_VADDRMODE : 0)),
+    (PCD8544_SETYADDR|b0),
+    (PCD8544_SETXADDR|x0)
+  };
+  send_data(spicfg, cmds, sizeof(cmds), DC_CMD);
+}
+
+static void
+pcd8544_contrast(spi_config_t *spicfg, uint8_t contrast)
+{
+  uint8_t cmds[] = {
+    (PCD8544_FUNCTIONSET|PCD8544_EXTINSTRUCTION),
+    (PCD8544_SETVOP|contrast)
+  };
+  send_data(spicfg, cmds, sizeof(cmds), DC_CMD);
+}
+
+const display_driver_t pcd8544_driver = {
+  .name       = "PCD8544",
+  .width      = PCD8544_DISPLAY_WIDTH,
+  .height     = PCD8544_DISPLAY_HEIGHT,
+  .init_cmds  = pcd8544_init_cmds,
+  .init_len   = sizeof(pcd8544_init_cmds),
+  .frame_cmds = pcd8544_address_init,
+  .frame_len  = sizeof(pcd8544_address_init),
+  .run_cost   = PCD8544_DIFF_RUN_COST,
+  .window     = false,
+  .address    = pcd8544_address,
+  .contrast   = pcd8544_contrast
+};
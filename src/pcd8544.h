@@ -0,0 +1,293 @@
+#ifndef PCD8544H_
+#define PCD8544H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_compat.h"
+#include "tiny_grafx.h"
+
+// PCD8544 function set
+#define PCD8544_FUNCTIONSET     0x20
+#define PCD8544_POWERDOWN       0x04
+#define PCD8544_VADDRMODE       0x02
+#define PCD8544_EXTINSTRUCTION  0x01
+#define PCD8544_DISPLAYBLANK    0x0
+#define PCD8544_DISPLAYNORMAL   0x4
+#define PCD8544_DISPLAYALLON    0x1
+#define PCD8544_DISPLAYINVERSE  0x5
+
+// PCD8544 basic instruction set
+#define PCD8544_DISPLAYCTRL     0x08
+#define PCD8544_SETYADDR        0x40
+#define PCD8544_SETXADDR        0x80
+
+// PCD8544 extended instruction set
+#define PCD8544_SETTEMP         0x04
+#define PCD8544_SETBIAS         0x10
+#define PCD8544_SETVOP          0x80
+
+// PCD8544 display config
+#define PCD8544_DISPLAY_WIDTH   84
+#define PCD8544_DISPLAY_HEIGHT  48
+#define PCD8544_DISPLAY_PIXEL   504
+#define PCD8544_FONT_WIDTH      8
+#define PCD8544_FONT_HEIGHT     8
+
+// Controller drivers
+#define DRIVER_PCD8544  0     // Nokia 5110, 84x48
+#define DRIVER_SSD1306  1     // 128x64 OLED
+
+// Largest display of the drivers
+#define DISPLAY_WIDTH_MAX   128
+#define DISPLAY_HEIGHT_MAX  64
+#define DISPLAY_PIXEL_MAX   (DISPLAY_WIDTH_MAX * DISPLAY_HEIGHT_MAX / 8)
+
+// D/C pin mode, command or data
+enum {
+    DC_CMD,
+    DC_DATA
+};
+
+// DMA channel
+#define NO_DMA  0
+#define DMA_CH1 1
+#define DMA_CH2 2
+
+// Flush mode, send the whole frame or only the changed bytes
+#define FLUSH_FULL  0
+#define FLUSH_DIFF  1
+
+// Diff flush cost of re-addressing the DDRAM, in bytes.
+// (3 command bytes plus the extra command/data transactions)
+#define PCD8544_DIFF_RUN_COST 8
+
+// Every bank of the frame, see pcd8544_send_banks
+#define PCD8544_BANKS_ALL     0xFF
+
+// Transport backend
+#define TRANSPORT_SPI   0     // ESP32 SPI master
+#define TRANSPORT_HOST  1     // in-memory controller emulation
+
+// default pcd8544 wiring and SPI configuration
+#define PCD8544_PIN_NUM_CS   5
+#define PCD8544_PIN_NUM_DC   16
+#define PCD8544_PIN_NUM_RST  17
+#define PCD8544_PIN_NUM_MOSI 23
+#define PCD8544_PIN_NUM_SCK  18
+#define PCD8544_PIN_NUM_MISO 19
+#define PCD8544_CLOCK_SPEED_HZ (4*1000*1000)   // SPI Clock freq=4 MHz
+#define PCD8544_SPI_MODE 0
+#define PCD8544_DMA DMA_CH1                    // default DMA channel = 1
+
+// Shared bus, panels on one bus and command/data segments queued per frame
+#define PCD8544_BUS_MAX_PANELS  4
+#define PCD8544_BUS_SEGMENTS    128
+
+// Background refresh task
+#define PCD8544_REFRESH_STACK     2048
+#define PCD8544_REFRESH_PRIORITY  5
+#define PCD8544_REFRESH_MAX_RATE  100         // frames per second
+#define PCD8544_GRAY_PLANES_MAX   3           // bit planes of the temporal grayscale
+
+#ifdef ESP_PLATFORM
+#define PCD8544_TRANSPORT TRANSPORT_SPI
+#else
+#define PCD8544_TRANSPORT TRANSPORT_HOST
+#endif
+
+// Draw calls counted per primitive
+enum {
+  STAT_PIXEL,
+  STAT_LINE,
+  STAT_VLINE,
+  STAT_HLINE,
+  STAT_RECT,
+  STAT_FILL_RECT,
+  STAT_CIRCLE,
+  STAT_FILL_CIRCLE,
+  STAT_TEXT,
+  STAT_BLIT,
+  STAT_FILL_TRIANGLE,
+  STAT_FILL_POLYGON,
+  STAT_FILL_ELLIPSE,
+  STAT_FILL_ROUND_RECT,
+  STAT_SCROLL,
+  STAT_RLE,
+  STAT_DITHER,
+  STAT_DRAW_MAX
+};
+
+// Runtime performance counters
+typedef struct pcd8544_stats_t {
+  uint32_t frames;          // frames flushed
+  uint32_t bytes;           // command and data bytes sent
+  uint32_t transactions;    // bus transactions
+  uint64_t send_us;         // time spent sending, including the waits in it [us]
+  uint64_t wait_us;         // time spent waiting for the transmission [us]
+  uint32_t spi_errors;      // failed transactions
+  uint32_t timeouts;        // timed out transactions
+  uint32_t latency_us;      // shared bus, time from the frame queued to sent [us]
+  uint32_t max_latency_us;  // shared bus, worst latency [us]
+  uint32_t skipped;         // refresh task, frames replaced before they were sent
+  uint32_t draw_calls[STAT_DRAW_MAX];
+} pcd8544_stats_t;
+
+struct pcd8544_transport_t;
+struct pcd8544_bus_t;
+struct pcd8544_bus_slot_t;
+struct pcd8544_refresh_t;
+struct display_driver_t;
+struct font_t;
+
+// Drawing state of a frame buffer, the panel's or a canvas'
+typedef struct draw_state_t {
+  tinygrafx_t tinygrafx;    // Tiny graphics config and frame buffer
+  int16_t color;            // Drawing color
+  int16_t fontsize;         // Text font size
+  const struct font_t *font;    // Text font, NULL for the 8x8 font
+  uint32_t *draw_calls;     // Draw calls counted per primitive
+} draw_state_t;
+
+// SPI Object start
+typedef struct spi_config_t {
+  uint8_t num_cs;           // Chip Select pin num
+  uint8_t num_dc;           // Data/Command select pin num
+  uint8_t num_rst;          // RESET pin num
+  uint8_t num_mosi;         // MOSI pin num
+  uint8_t num_sck;          // SPI Clock pin num
+  uint8_t num_miso;         // MISO pin num
+  uint32_t spi_freq;        // SPI clock frequency [Hz]
+  uint8_t spi_mode;         // SPI mode (0-3)
+  uint8_t dma_ch;           // No DMA or DMA channel (1 or 2)
+  bool require_reset;       // Reset the display
+  uint8_t flush_mode;       // FLUSH_FULL or FLUSH_DIFF
+  bool shown_valid;         // back buffer holds the frame shown on the display at swap time
+  uint8_t *front_buffer;    // Frame buffer being sent to the display
+  uint8_t *strip_buffer;    // Transmit buffer for the vertical addressing strip
+  const struct display_driver_t *driver;        // Controller driver
+  const struct pcd8544_transport_t *transport;  // Transport backend
+  void *transport_data;     // Transport backend state
+  draw_state_t draw;        // Frame buffer and drawing state
+  pcd8544_stats_t stats;    // Performance counters
+  struct pcd8544_bus_t *bus;            // Shared bus, NULL if the panel owns the bus
+  struct pcd8544_bus_slot_t *bus_slot;  // Frame queue of the panel on the shared bus
+  struct pcd8544_refresh_t *refresh;    // Background refresh task, NULL if not running
+} spi_config_t;
+
+// Command or data bytes of a queued frame.
+// Up to 4 bytes are copied, longer data must stay valid until it is sent.
+typedef struct pcd8544_segment_t {
+  const uint8_t *data;
+  uint8_t bytes[4];
+  int16_t len;
+  uint8_t dc;
+} pcd8544_segment_t;
+
+// A panel on the shared bus
+typedef struct pcd8544_bus_slot_t {
+  spi_config_t *panel;      // NULL if the slot is free
+  pcd8544_segment_t segments[PCD8544_BUS_SEGMENTS];  // Queued frame
+  int16_t count;            // Number of queued segments
+  int16_t next;             // Next segment to send
+  int32_t dc;               // D/C level of the last segment sent
+  bool done;                // Frame sent
+} pcd8544_bus_slot_t;
+
+// Shared bus. Owns the SPI host, queues the frames of several panels and
+// interleaves their transactions. Allocated with malloc, it is released when
+// the last user (the Bus object or a panel) releases it.
+typedef struct pcd8544_bus_t {
+  uint8_t num_mosi;         // MOSI pin num
+  uint8_t num_sck;          // SPI Clock pin num
+  uint8_t num_miso;         // MISO pin num
+  uint8_t dma_ch;           // No DMA or DMA channel (1 or 2)
+  bool owns_host;           // the SPI host was initialized by the bus
+  bool recording;           // queue the frames instead of sending them
+  int16_t refs;             // Number of users
+  const struct pcd8544_transport_t *transport;  // Transport backend
+  pcd8544_bus_slot_t slots[PCD8544_BUS_MAX_PANELS];
+} pcd8544_bus_t;
+
+// Transport backend.
+// Moves the command/data byte stream of the PCD8544 protocol layer to the
+// display. "send" may return before the bytes are transmitted, the data must
+// stay valid until "wait" (up to 4 bytes are copied by the backend).
+typedef struct pcd8544_transport_t {
+  const char *name;
+  esp_err_t (*init)(spi_config_t *spicfg);    // set up the bus and control lines
+  void (*deinit)(spi_config_t *spicfg);
+  void (*reset)(spi_config_t *spicfg);        // pulse the RST line
+  void (*send)(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc);
+  void (*wait)(spi_config_t *spicfg);         // wait for the bytes sent
+  bool (*busy)(spi_config_t *spicfg);         // true while bytes are in flight
+  uint8_t *(*alloc)(spi_config_t *spicfg, int16_t size);  // buffer "send" can transmit
+  void (*free)(spi_config_t *spicfg, uint8_t *buffer);
+  bool queued_dc;           // the D/C line follows each queued transaction
+  esp_err_t (*bus_init)(pcd8544_bus_t *bus);  // set up the shared bus
+  void (*bus_deinit)(pcd8544_bus_t *bus);
+} pcd8544_transport_t;
+
+// Controller driver.
+// Geometry, init sequence and addressing of a display controller. The
+// controller RAM has the page layout of the frame buffer, the protocol layer
+// builds the full, bank and diff flushes on the driver's commands. Command
+// sequences longer than 4 bytes must stay valid until they are sent.
+typedef struct display_driver_t {
+  const char *name;
+  int16_t width;            // display size [pixel], the height is a multiple of 8
+  int16_t height;
+  const uint8_t *init_cmds; // sent after the reset
+  int16_t init_len;
+  const uint8_t *frame_cmds;    // sent before a whole frame, address column 0 of bank 0
+  int16_t frame_len;
+  int16_t run_cost;         // diff flush cost of re-addressing, in bytes
+  bool window;              // the address limits the RAM to x0-x1, b0-b1
+  // Address column x0 of bank b0. Without a window the address wraps at the
+  // display edges: to the next bank, or to the next column if vertical.
+  void (*address)(spi_config_t *spicfg, int16_t x0, int16_t b0, int16_t x1, int16_t b1, bool vertical);
+  void (*contrast)(spi_config_t *spicfg, uint8_t contrast);   // contrast 0-127
+} display_driver_t;
+
+extern const display_driver_t pcd8544_driver;
+extern const display_driver_t ssd1306_driver;
+
+#ifdef ESP_PLATFORM
+extern const pcd8544_transport_t pcd8544_spi_transport;
+#endif
+extern const pcd8544_transport_t pcd8544_host_transport;
+
+// In-memory display of the host transport
+const uint8_t *host_transport_ddram(spi_config_t *spicfg);
+
+// PCD8544 protocol layer
+esp_err_t pcd8544_open(spi_config_t *spicfg, int16_t driver, int16_t transport);
+void pcd8544_close(spi_config_t *spicfg);
+void pcd8544_send_display(spi_config_t *spicfg);
+void pcd8544_send_banks(spi_config_t *spicfg, uint8_t banks);
+void pcd8544_send_frame(spi_config_t *spicfg, const uint8_t *frame, const uint8_t *shown, uint8_t banks);
+void pcd8544_send_cmds(spi_config_t *spicfg, const uint8_t *cmds, int16_t len);
+void pcd8544_wait(spi_config_t *spicfg);
+bool pcd8544_busy(spi_config_t *spicfg);
+void pcd8544_set_contrast(spi_config_t *spicfg, uint8_t contrast);
+void pcd8544_reset_stats(spi_config_t *spicfg);
+const pcd8544_transport_t *pcd8544_transport(int16_t transport);
+const display_driver_t *display_driver(int16_t driver);
+
+// Shared bus
+esp_err_t pcd8544_bus_open(pcd8544_bus_t *bus, int16_t transport);
+void pcd8544_bus_release(pcd8544_bus_t *bus);
+esp_err_t pcd8544_bus_attach(pcd8544_bus_t *bus, spi_config_t *spicfg);
+void pcd8544_bus_detach(spi_config_t *spicfg);
+void pcd8544_bus_record(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc);
+void pcd8544_bus_display(pcd8544_bus_t *bus);
+
+// Background refresh task
+esp_err_t pcd8544_refresh_start(spi_config_t *spicfg, uint16_t rate);
+void pcd8544_refresh_stop(spi_config_t *spicfg);
+void pcd8544_refresh_present(spi_config_t *spicfg);
+void pcd8544_refresh_contrast(spi_config_t *spicfg, uint8_t contrast);
+esp_err_t pcd8544_refresh_gray(spi_config_t *spicfg, int16_t planes);
+int16_t pcd8544_refresh_planes(spi_config_t *spicfg, tinygrafx_t *planes);
+void pcd8544_refresh_gray_clear(spi_config_t *spicfg);
+
+#endif /* PCD8544H_ */
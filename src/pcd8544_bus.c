@@ -0,0 +1,210 @@
+// PCD8544 shared bus.
+// Several panels on one SPI host. The frames of all panels are queued as
+// command/data segments, then their transactions are interleaved on the bus.
+// If the transport can only change the D/C line between transactions, the
+// other panels send while a panel waits for its D/C line to change.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcd8544.h"
+
+static const char *TAG = "PCD8544_BUS";
+
+// Open the shared bus on the transport backend
+esp_err_t
+pcd8544_bus_open(pcd8544_bus_t *bus, int16_t transport)
+{
+  bus->transport = pcd8544_transport(transport);
+  if (bus->transport == NULL) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  bus->recording = false;
+  bus->owns_host = false;
+  bus->refs = 1;
+  memset(bus->slots, 0, sizeof(bus->slots));
+
+  esp_err_t err = bus->transport->bus_init(bus);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "pcd8544_bus_open: %s bus init error=%d", bus->transport->name, err);
+  }
+  return err;
+}
+
+// Drop a reference, the bus is freed with the last one
+void
+pcd8544_bus_release(pcd8544_bus_t *bus)
+{
+  if (--bus->refs > 0) return;
+
+  if (bus->transport != NULL) {
+    bus->transport->bus_deinit(bus);
+  }
+  free(bus);
+}
+
+// Attach a panel to the bus. The display is reset unless a panel already
+// attached shares its RST line.
+esp_err_t
+pcd8544_bus_attach(pcd8544_bus_t *bus, spi_config_t *spicfg)
+{
+  pcd8544_bus_slot_t *free_slot = NULL;
+
+  spicfg->require_reset = true;
+  for (int16_t i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+    pcd8544_bus_slot_t *slot = &bus->slots[i];
+    if (slot->panel == NULL) {
+      if (free_slot == NULL) free_slot = slot;
+    } else if (slot->panel->num_rst == spicfg->num_rst) {
+      spicfg->require_reset = false;
+    }
+  }
+  if (free_slot == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  free_slot->panel = spicfg;
+  free_slot->count = 0;
+  free_slot->next = 0;
+  free_slot->dc = DC_CMD;
+  spicfg->bus_slot = free_slot;
+  spicfg->num_mosi = bus->num_mosi;
+  spicfg->num_sck = bus->num_sck;
+  spicfg->num_miso = bus->num_miso;
+  spicfg->dma_ch = bus->dma_ch;
+  bus->refs++;
+  return ESP_OK;
+}
+
+// Detach the panel from its bus
+void
+pcd8544_bus_detach(spi_config_t *spicfg)
+{
+  if (spicfg->bus == NULL) return;
+
+  if (spicfg->bus_slot != NULL) {
+    spicfg->bus_slot->panel = NULL;
+    spicfg->bus_slot = NULL;
+  }
+  pcd8544_bus_release(spicfg->bus);
+  spicfg->bus = NULL;
+}
+
+// Send a queued segment to the panel
+static void
+bus_send(spi_config_t *spicfg, const pcd8544_segment_t *seg)
+{
+  int64_t start = esp_timer_get_time();
+  const uint8_t *data = (seg->len <= sizeof(seg->bytes)) ? seg->bytes : seg->data;
+
+  spicfg->transport->send(spicfg, data, seg->len, seg->dc);
+  spicfg->stats.send_us += esp_timer_get_time() - start;
+  spicfg->bus_slot->dc = seg->dc;
+}
+
+// Queue a segment of the frame. When the queue is full, the queued segments
+// are sent at once to keep the order.
+void
+pcd8544_bus_record(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  pcd8544_bus_slot_t *slot = spicfg->bus_slot;
+
+  if (slot->count == PCD8544_BUS_SEGMENTS) {
+    while (slot->next < slot->count) {
+      bus_send(spicfg, &slot->segments[slot->next++]);
+    }
+    slot->count = 0;
+    slot->next = 0;
+  }
+
+  pcd8544_segment_t *seg = &slot->segments[slot->count++];
+  seg->len = len;
+  seg->dc = dc;
+  if (len <= sizeof(seg->bytes)) {
+    memcpy(seg->bytes, data, len);
+    seg->data = NULL;
+  } else {
+    seg->data = data;
+  }
+}
+
+// The D/C line can be set to "dc" once no panel using the same D/C pin has
+// transactions of the other level in flight. No need to wait if the
+// transport sets the D/C line for each transaction.
+static bool
+bus_dc_ready(pcd8544_bus_t *bus, pcd8544_bus_slot_t *slot, int32_t dc)
+{
+  if (slot->panel->transport->queued_dc) return true;
+
+  for (int16_t i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+    pcd8544_bus_slot_t *other = &bus->slots[i];
+    if ((other->panel == NULL) || (other->panel->num_dc != slot->panel->num_dc)) continue;
+    if ((other->dc != dc) && other->panel->transport->busy(other->panel)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Send the frames of all panels on the bus and wait for them.
+// Each panel queues its frame, then the segments are sent round-robin.
+// A panel that has to change its D/C line is skipped until its transactions
+// are done, while the other panels keep the bus busy.
+void
+pcd8544_bus_display(pcd8544_bus_t *bus)
+{
+  int16_t pending = 0;
+
+  // queue the frames
+  bus->recording = true;
+  for (int16_t i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+    pcd8544_bus_slot_t *slot = &bus->slots[i];
+    if (slot->panel == NULL) continue;
+    slot->count = 0;
+    slot->next = 0;
+    slot->done = false;
+    pcd8544_send_display(slot->panel);
+    pending++;
+  }
+  bus->recording = false;
+
+  int64_t start = esp_timer_get_time();
+  while (pending > 0) {
+    bool progress = false;
+
+    for (int16_t i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+      pcd8544_bus_slot_t *slot = &bus->slots[i];
+      spi_config_t *panel = slot->panel;
+      if ((panel == NULL) || slot->done) continue;
+
+      if (slot->next < slot->count) {
+        pcd8544_segment_t *seg = &slot->segments[slot->next];
+        if (!bus_dc_ready(bus, slot, seg->dc)) continue;
+        bus_send(panel, seg);
+        slot->next++;
+        progress = true;
+      } else if (!panel->transport->busy(panel)) {
+        uint32_t latency = esp_timer_get_time() - start;
+        panel->stats.latency_us = latency;
+        if (latency > panel->stats.max_latency_us) {
+          panel->stats.max_latency_us = latency;
+        }
+        slot->done = true;
+        pending--;
+        progress = true;
+      }
+    }
+
+    // every panel waits for its own transactions, block on the first one
+    if (!progress) {
+      for (int16_t i = 0; i < PCD8544_BUS_MAX_PANELS; i++) {
+        pcd8544_bus_slot_t *slot = &bus->slots[i];
+        if ((slot->panel != NULL) && !slot->done && slot->panel->transport->busy(slot->panel)) {
+          pcd8544_wait(slot->panel);
+          break;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,287 @@
+// PCD8544 transport backend for host builds.
+// Decodes the command/data byte stream like the controller of the panel's
+// driver does (PCD8544 or SSD1306) and keeps the result in an emulated
+// display RAM, so the rendering and flush code can be run and inspected
+// without hardware.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcd8544.h"
+#include "ssd1306.h"
+
+// Emulated controller state
+typedef struct host_transport_t {
+  uint8_t ddram[DISPLAY_PIXEL_MAX];   // Display data RAM, same layout as the frame buffer
+  bool ssd1306;             // SSD1306 command set, PCD8544 otherwise
+  uint8_t width;            // RAM size, columns and banks
+  uint8_t banks;
+  uint8_t x;                // X address (column)
+  uint8_t y;                // Y address (bank)
+  uint8_t x0, x1;           // address window, the whole RAM on the PCD8544
+  uint8_t y0, y1;
+  uint8_t mode;             // addressing mode, SSD1306_HORIZONTAL, _VERTICAL or _PAGE
+  bool extended;            // H: extended instruction set
+  bool power_down;          // PD: power down, SSD1306 display off
+  uint8_t display_mode;     // D and E bits of display control
+  uint8_t vop;              // contrast
+  uint8_t cmd;              // SSD1306 command waiting for its parameters
+  uint8_t params;           // number of parameters still to come
+  uint8_t param[2];         // parameters received so far (the first two)
+  uint8_t count;
+} host_transport_t;
+
+// Decode a PCD8544 command byte
+static void
+host_command(host_transport_t *lcd, uint8_t cmd)
+{
+  if ((cmd & 0xE0) == PCD8544_FUNCTIONSET) {
+    lcd->power_down = (cmd & PCD8544_POWERDOWN) != 0;
+    lcd->mode = (cmd & PCD8544_VADDRMODE) ? SSD1306_VERTICAL : SSD1306_HORIZONTAL;
+    lcd->extended = (cmd & PCD8544_EXTINSTRUCTION) != 0;
+  } else if (lcd->extended) {
+    if (cmd & PCD8544_SETVOP) {
+      lcd->vop = cmd & 0x7F;
+    }
+    // temperature coefficient and bias system are not emulated
+  } else if (cmd & PCD8544_SETXADDR) {
+    lcd->x = (cmd & 0x7F) % lcd->width;
+  } else if (cmd & PCD8544_SETYADDR) {
+    lcd->y = (cmd & 0x07) % lcd->banks;
+  } else if (cmd & PCD8544_DISPLAYCTRL) {
+    lcd->display_mode = cmd & 0x05;
+  }
+}
+
+// Number of parameter bytes of an SSD1306 command
+static uint8_t
+ssd1306_params(uint8_t cmd)
+{
+  switch (cmd) {
+    case SSD1306_MEMORYMODE:
+    case SSD1306_SETCONTRAST:
+    case SSD1306_SETMULTIPLEX:
+    case SSD1306_SETDISPLAYOFFSET:
+    case SSD1306_SETCOMPINS:
+    case SSD1306_SETCLOCKDIV:
+    case SSD1306_SETPRECHARGE:
+    case SSD1306_SETVCOMDETECT:
+    case SSD1306_CHARGEPUMP:
+      return 1;
+    case SSD1306_COLUMNADDR:
+    case SSD1306_PAGEADDR:
+    case 0xA3:              // vertical scroll area
+      return 2;
+    case 0x29:              // vertical and horizontal scroll
+    case 0x2A:
+      return 5;
+    case 0x26:              // horizontal scroll
+    case 0x27:
+      return 6;
+    default:
+      return 0;
+  }
+}
+
+// Execute an SSD1306 command with its parameters.
+// Charge pump, timing and scrolling are not emulated.
+static void
+ssd1306_execute(host_transport_t *lcd, uint8_t cmd)
+{
+  switch (cmd) {
+    case SSD1306_MEMORYMODE:
+      lcd->mode = lcd->param[0] & 0x03;
+      break;
+    case SSD1306_COLUMNADDR:
+      lcd->x0 = lcd->param[0] % lcd->width;
+      lcd->x1 = lcd->param[1] % lcd->width;
+      lcd->x = lcd->x0;
+      break;
+    case SSD1306_PAGEADDR:
+      lcd->y0 = lcd->param[0] % lcd->banks;
+      lcd->y1 = lcd->param[1] % lcd->banks;
+      lcd->y = lcd->y0;
+      break;
+    case SSD1306_SETCONTRAST:
+      lcd->vop = lcd->param[0];
+      break;
+    case SSD1306_DISPLAYOFF:
+    case SSD1306_DISPLAYON:
+      lcd->power_down = (cmd == SSD1306_DISPLAYOFF);
+      break;
+    case SSD1306_NORMALDISPLAY:
+    case SSD1306_INVERTDISPLAY:
+      lcd->display_mode = cmd & 0x01;
+      break;
+    default:
+      if (lcd->mode != SSD1306_PAGE) break;
+      // column and page start of the page addressing mode
+      if ((cmd & 0xF8) == SSD1306_SETPAGE) {
+        lcd->y = (cmd & 0x07) % lcd->banks;
+      } else if ((cmd & 0xF0) == SSD1306_SETLOWCOLUMN) {
+        lcd->x = ((lcd->x & 0xF0) | (cmd & 0x0F)) % lcd->width;
+      } else if ((cmd & 0xF0) == SSD1306_SETHIGHCOLUMN) {
+        lcd->x = ((lcd->x & 0x0F) | ((cmd & 0x0F) << 4)) % lcd->width;
+      }
+      break;
+  }
+}
+
+// Decode an SSD1306 command or parameter byte
+static void
+ssd1306_command(host_transport_t *lcd, uint8_t cmd)
+{
+  if (lcd->params > 0) {
+    if (lcd->count < sizeof(lcd->param)) {
+      lcd->param[lcd->count] = cmd;
+    }
+    lcd->count++;
+    if (--lcd->params == 0) {
+      ssd1306_execute(lcd, lcd->cmd);
+    }
+    return;
+  }
+  lcd->cmd = cmd;
+  lcd->count = 0;
+  lcd->params = ssd1306_params(cmd);
+  if (lcd->params == 0) {
+    ssd1306_execute(lcd, cmd);
+  }
+}
+
+// Write a data byte and advance the address inside the window
+static void
+host_data(host_transport_t *lcd, uint8_t data)
+{
+  lcd->ddram[lcd->x + lcd->y * lcd->width] = data;
+
+  if (lcd->mode == SSD1306_PAGE) {
+    if (++lcd->x == lcd->width) {
+      lcd->x = 0;
+    }
+  } else if (lcd->mode == SSD1306_VERTICAL) {
+    if (lcd->y++ == lcd->y1) {
+      lcd->y = lcd->y0;
+      lcd->x = (lcd->x == lcd->x1) ? lcd->x0 : (lcd->x + 1);
+    }
+  } else {
+    if (lcd->x++ == lcd->x1) {
+      lcd->x = lcd->x0;
+      lcd->y = (lcd->y == lcd->y1) ? lcd->y0 : (lcd->y + 1);
+    }
+  }
+}
+
+static void
+host_send(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  host_transport_t *lcd = spicfg->transport_data;
+
+  spicfg->stats.transactions++;
+  for (int16_t i = 0; i < len; i++) {
+    if (dc == DC_DATA) {
+      host_data(lcd, data[i]);
+    } else if (lcd->ssd1306) {
+      ssd1306_command(lcd, data[i]);
+    } else {
+      host_command(lcd, data[i]);
+    }
+  }
+}
+
+// The bytes are decoded synchronously, nothing is ever in flight
+static void
+host_wait(spi_config_t *spicfg)
+{
+}
+
+static bool
+host_busy(spi_config_t *spicfg)
+{
+  return false;
+}
+
+// Power on state of the controller, the RAM is cleared.
+// The PCD8544 addresses the whole RAM, the SSD1306 starts in page mode.
+static void
+host_reset(spi_config_t *spicfg)
+{
+  host_transport_t *lcd = spicfg->transport_data;
+  memset(lcd, 0, sizeof(host_transport_t));
+  lcd->ssd1306 = (spicfg->driver == &ssd1306_driver);
+  lcd->width = spicfg->driver->width;
+  lcd->banks = spicfg->driver->height / 8;
+  lcd->x1 = lcd->width - 1;
+  lcd->y1 = lcd->banks - 1;
+  lcd->mode = lcd->ssd1306 ? SSD1306_PAGE : SSD1306_HORIZONTAL;
+}
+
+static esp_err_t
+host_init(spi_config_t *spicfg)
+{
+  host_transport_t *lcd = (host_transport_t *)calloc(1, sizeof(host_transport_t));
+  if (lcd == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  spicfg->transport_data = lcd;
+  spicfg->require_reset = true;
+  host_reset(spicfg);
+  return ESP_OK;
+}
+
+static void
+host_deinit(spi_config_t *spicfg)
+{
+  free(spicfg->transport_data);
+  spicfg->transport_data = NULL;
+}
+
+static uint8_t *
+host_alloc(spi_config_t *spicfg, int16_t size)
+{
+  return (uint8_t *)malloc(size);
+}
+
+static void
+host_free(spi_config_t *spicfg, uint8_t *buffer)
+{
+  free(buffer);
+}
+
+// Emulated DDRAM, or NULL if the display does not use the host transport
+const uint8_t *
+host_transport_ddram(spi_config_t *spicfg)
+{
+  if (spicfg->transport != &pcd8544_host_transport) return NULL;
+
+  host_transport_t *lcd = spicfg->transport_data;
+  return lcd->ddram;
+}
+
+// The emulated panels need no shared bus setup
+static esp_err_t
+host_bus_init(pcd8544_bus_t *bus)
+{
+  return ESP_OK;
+}
+
+static void
+host_bus_deinit(pcd8544_bus_t *bus)
+{
+}
+
+const pcd8544_transport_t pcd8544_host_transport = {
+  .name   = "host",
+  .init   = host_init,
+  .deinit = host_deinit,
+  .reset  = host_reset,
+  .send   = host_send,
+  .wait   = host_wait,
+  .busy   = host_busy,
+  .alloc  = host_alloc,
+  .free   = host_free,
+  .queued_dc  = true,
+  .bus_init   = host_bus_init,
+  .bus_deinit = host_bus_deinit
+};
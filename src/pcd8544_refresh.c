@@ -0,0 +1,310 @@
+// PCD8544 background refresh task.
+// The mruby VM draws and hands over completed frames, a task pinned to the
+// other core sends the newest frame at a fixed rate. The frames are exchanged
+// through three buffers without locks:
+//   back    - the VM draws into it (draw.tinygrafx.display_buffer)
+//   middle  - the newest completed frame, or the last one taken by the task
+//   present - the frame the task is sending
+// Handing over swaps back and middle, taking swaps present and middle, each
+// with one atomic exchange, so neither side waits for the other.
+// On a host build there is no task, the frame is sent when it is handed over.
+//
+// Temporal grayscale shows 2 or 3 bit planes of every frame in turn, one per
+// period. The first plane is the frame itself, each following plane is the
+// frame XOR an overlay. The overlays are exchanged together with the frames,
+// they are zero wherever nothing gray is drawn.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#include "pcd8544.h"
+
+// exchange word, index of the middle buffer and the new frame flag
+#define REFRESH_INDEX_MASK  0x03
+#define REFRESH_FRESH       0x04
+
+// no contrast change pending
+#define REFRESH_NO_CONTRAST -1
+
+typedef struct pcd8544_refresh_t {
+  uint8_t *frames[3];       // back, middle and present buffers
+  uint8_t *shown;           // frame shown on the display, the diff reference
+  atomic_uint exchange;     // middle buffer index | REFRESH_FRESH
+  uint8_t back;             // index of the VM's buffer
+  uint8_t present;          // index of the task's buffer
+  uint32_t period_ms;       // refresh period [ms]
+  atomic_int contrast;      // contrast to set, or REFRESH_NO_CONTRAST
+  atomic_bool stop;         // request to stop the task
+  atomic_bool running;      // the task is running
+  uint8_t *overlays[3];     // temporal grayscale, overlays of the planes after the first, per frame
+  uint8_t *composite;       // plane being sent, a frame with an overlay applied
+  atomic_int planes;        // planes shown in turn, 1 without grayscale
+  int16_t plane;            // plane sent last
+#ifdef ESP_PLATFORM
+  TaskHandle_t task;
+#endif
+} pcd8544_refresh_t;
+
+// Bytes of the overlays of a frame
+#define REFRESH_OVERLAYS_SIZE(spicfg) \
+  ((PCD8544_GRAY_PLANES_MAX - 1) * (spicfg)->draw.tinygrafx.display_pixel)
+
+// Send the newest frame if there is one, or the next plane of the frame
+// with temporal grayscale, called by the task
+static void
+refresh_step(spi_config_t *spicfg)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+  int16_t size = spicfg->draw.tinygrafx.display_pixel;
+  int planes = atomic_load(&rf->planes);
+  int contrast = atomic_exchange(&rf->contrast, REFRESH_NO_CONTRAST);
+
+  if (contrast != REFRESH_NO_CONTRAST) {
+    spicfg->driver->contrast(spicfg, contrast & 0x7F);
+    spicfg->transport->wait(spicfg);
+  }
+
+  bool fresh = (atomic_load(&rf->exchange) & REFRESH_FRESH) != 0;
+  if (!fresh && (planes == 1) && (rf->plane == 0)) return;
+
+  if (fresh) {
+    // take the newest frame, leave the presented one as the middle buffer
+    unsigned int old = atomic_exchange(&rf->exchange, rf->present);
+    rf->present = old & REFRESH_INDEX_MASK;
+  }
+  rf->plane = (rf->plane + 1) % planes;
+
+  const uint8_t *frame = rf->frames[rf->present];
+  if (rf->plane > 0) {
+    const uint8_t *overlay = rf->overlays[rf->present] + (rf->plane - 1) * size;
+    for (int16_t i = 0; i < size; i++) {
+      rf->composite[i] = frame[i] ^ overlay[i];
+    }
+    frame = rf->composite;
+  }
+  pcd8544_send_frame(spicfg, frame, rf->shown, PCD8544_BANKS_ALL);
+  spicfg->transport->wait(spicfg);
+  memcpy(rf->shown, frame, size);
+}
+
+#ifdef ESP_PLATFORM
+static const char *TAG = "PCD8544_REFRESH";
+
+// The refresh task, wakes up every period
+static void
+refresh_task(void *arg)
+{
+  spi_config_t *spicfg = arg;
+  pcd8544_refresh_t *rf = spicfg->refresh;
+  TickType_t period = rf->period_ms / portTICK_PERIOD_MS;
+  TickType_t last_wake = xTaskGetTickCount();
+
+  if (period == 0) period = 1;
+  while (!atomic_load(&rf->stop)) {
+    refresh_step(spicfg);
+    vTaskDelayUntil(&last_wake, period);
+  }
+  atomic_store(&rf->running, false);
+  vTaskDelete(NULL);
+}
+#endif
+
+// Free the buffers of the refresh state, except "keep"
+static void
+refresh_free(spi_config_t *spicfg, pcd8544_refresh_t *rf, const uint8_t *keep1, const uint8_t *keep2)
+{
+  for (int i = 0; i < 3; i++) {
+    if ((rf->frames[i] != NULL) && (rf->frames[i] != keep1) && (rf->frames[i] != keep2)) {
+      spicfg->transport->free(spicfg, rf->frames[i]);
+    }
+    free(rf->overlays[i]);
+  }
+  if (rf->composite != NULL) {
+    spicfg->transport->free(spicfg, rf->composite);
+  }
+  free(rf->shown);
+  free(rf);
+}
+
+// Start the refresh task, "rate" frames per second.
+// The task takes over the transport, the frame on the display is kept.
+esp_err_t
+pcd8544_refresh_start(spi_config_t *spicfg, uint16_t rate)
+{
+  if (spicfg->refresh != NULL) return ESP_ERR_INVALID_STATE;
+  if (spicfg->bus != NULL) return ESP_ERR_NOT_SUPPORTED;
+  if ((rate == 0) || (rate > PCD8544_REFRESH_MAX_RATE)) return ESP_ERR_INVALID_ARG;
+
+  int16_t size = spicfg->draw.tinygrafx.display_pixel;
+  pcd8544_refresh_t *rf = (pcd8544_refresh_t *)calloc(1, sizeof(pcd8544_refresh_t));
+  if (rf == NULL) return ESP_ERR_NO_MEM;
+
+  // back and middle are the buffers of the display, present is a new one
+  rf->frames[0] = spicfg->draw.tinygrafx.display_buffer;
+  rf->frames[1] = spicfg->front_buffer;
+  rf->frames[2] = spicfg->transport->alloc(spicfg, size);
+  rf->shown = (uint8_t *)malloc(size);
+  if ((rf->frames[2] == NULL) || (rf->shown == NULL)) {
+    refresh_free(spicfg, rf, rf->frames[0], rf->frames[1]);
+    return ESP_ERR_NO_MEM;
+  }
+  pcd8544_wait(spicfg);
+  memcpy(rf->shown, spicfg->front_buffer, size);
+  memcpy(rf->frames[2], spicfg->front_buffer, size);
+  rf->back = 0;
+  rf->present = 2;
+  atomic_init(&rf->exchange, 1);
+  atomic_init(&rf->contrast, REFRESH_NO_CONTRAST);
+  atomic_init(&rf->stop, false);
+  atomic_init(&rf->running, true);
+  atomic_init(&rf->planes, 1);
+  rf->period_ms = 1000 / rate;
+  spicfg->refresh = rf;
+
+#ifdef ESP_PLATFORM
+  // run on the core the VM is not running on
+  BaseType_t core = (xPortGetCoreID() == 0) ? 1 : 0;
+  if (xTaskCreatePinnedToCore(refresh_task, "pcd8544_refresh", PCD8544_REFRESH_STACK, spicfg,
+                              PCD8544_REFRESH_PRIORITY, &rf->task, core) != pdPASS) {
+    spicfg->refresh = NULL;
+    refresh_free(spicfg, rf, rf->frames[0], rf->frames[1]);
+    return ESP_ERR_NO_MEM;
+  }
+  ESP_LOGI(TAG, "refresh task started on core %d, %d ms", (int)core, (int)rf->period_ms);
+#endif
+  return ESP_OK;
+}
+
+// Stop the refresh task. The VM keeps its drawing buffer, the display
+// keeps the last frame sent.
+void
+pcd8544_refresh_stop(spi_config_t *spicfg)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+  if (rf == NULL) return;
+
+#ifdef ESP_PLATFORM
+  atomic_store(&rf->stop, true);
+  while (atomic_load(&rf->running)) {
+    vTaskDelay(1);
+  }
+#endif
+  spicfg->refresh = NULL;
+
+  // keep two of the buffers for the display, the front buffer holds the
+  // frame on the display
+  uint8_t *back = rf->frames[rf->back];
+  uint8_t *front = rf->frames[(rf->back == 0) ? 1 : 0];
+  memcpy(front, rf->shown, spicfg->draw.tinygrafx.display_pixel);
+  spicfg->draw.tinygrafx.display_buffer = back;
+  spicfg->front_buffer = front;
+  refresh_free(spicfg, rf, back, front);
+}
+
+// Hand over the frame drawn by the VM, continue drawing on a copy of it.
+// A frame handed over before the task took the previous one replaces it.
+void
+pcd8544_refresh_present(spi_config_t *spicfg)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+  unsigned int old = atomic_exchange(&rf->exchange, rf->back | REFRESH_FRESH);
+  uint8_t *frame = rf->frames[rf->back];
+  uint8_t old_back = rf->back;
+
+  if (old & REFRESH_FRESH) {
+    spicfg->stats.skipped++;
+  }
+  rf->back = old & REFRESH_INDEX_MASK;
+  memcpy(rf->frames[rf->back], frame, spicfg->draw.tinygrafx.display_pixel);
+  if (atomic_load(&rf->planes) > 1) {
+    memcpy(rf->overlays[rf->back], rf->overlays[old_back], REFRESH_OVERLAYS_SIZE(spicfg));
+  }
+  spicfg->draw.tinygrafx.display_buffer = rf->frames[rf->back];
+
+#ifndef ESP_PLATFORM
+  refresh_step(spicfg);
+#endif
+}
+
+// Set the contrast from the refresh task
+void
+pcd8544_refresh_contrast(spi_config_t *spicfg, uint8_t contrast)
+{
+  atomic_store(&spicfg->refresh->contrast, contrast);
+#ifndef ESP_PLATFORM
+  refresh_step(spicfg);
+#endif
+}
+
+// Show "planes" bit planes of every frame in turn (2 or 3), or only the
+// frame (1). The overlays are allocated the first time, and all of them
+// are cleared when the grayscale is turned on.
+esp_err_t
+pcd8544_refresh_gray(spi_config_t *spicfg, int16_t planes)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+
+  if (rf == NULL) return ESP_ERR_INVALID_STATE;
+  if ((planes < 1) || (planes > PCD8544_GRAY_PLANES_MAX)) return ESP_ERR_INVALID_ARG;
+
+  if ((planes > 1) && (rf->composite == NULL)) {
+    for (int i = 0; i < 3; i++) {
+      rf->overlays[i] = (uint8_t *)calloc(1, REFRESH_OVERLAYS_SIZE(spicfg));
+    }
+    rf->composite = spicfg->transport->alloc(spicfg, spicfg->draw.tinygrafx.display_pixel);
+    if ((rf->overlays[0] == NULL) || (rf->overlays[1] == NULL) || (rf->overlays[2] == NULL) ||
+        (rf->composite == NULL)) {
+      for (int i = 0; i < 3; i++) {
+        free(rf->overlays[i]);
+        rf->overlays[i] = NULL;
+      }
+      if (rf->composite != NULL) {
+        spicfg->transport->free(spicfg, rf->composite);
+        rf->composite = NULL;
+      }
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  if ((planes > 1) && (atomic_load(&rf->planes) == 1)) {
+    // the task doesn't read the overlays of one plane, so none is in use
+    for (int i = 0; i < 3; i++) {
+      memset(rf->overlays[i], 0, REFRESH_OVERLAYS_SIZE(spicfg));
+    }
+  }
+  atomic_store(&rf->planes, planes);
+  return ESP_OK;
+}
+
+// The frame buffers the VM draws the planes of a grayscale image into:
+// the frame, then the overlays of the following planes. Returns the number
+// of planes, 1 without temporal grayscale.
+int16_t
+pcd8544_refresh_planes(spi_config_t *spicfg, tinygrafx_t *planes)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+  int16_t count = (rf == NULL) ? 1 : atomic_load(&rf->planes);
+
+  planes[0] = spicfg->draw.tinygrafx;
+  for (int16_t k = 1; k < count; k++) {
+    planes[k] = spicfg->draw.tinygrafx;
+    planes[k].display_buffer = rf->overlays[rf->back] + (k - 1) * spicfg->draw.tinygrafx.display_pixel;
+  }
+  return count;
+}
+
+// Clear the VM's overlays, nothing is gray any more
+void
+pcd8544_refresh_gray_clear(spi_config_t *spicfg)
+{
+  pcd8544_refresh_t *rf = spicfg->refresh;
+
+  if ((rf == NULL) || (rf->overlays[rf->back] == NULL)) return;
+  memset(rf->overlays[rf->back], 0, REFRESH_OVERLAYS_SIZE(spicfg));
+}
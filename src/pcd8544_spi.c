@@ -0,0 +1,359 @@
+// PCD8544 transport backend for the ESP32 SPI master.
+
+#ifdef ESP_PLATFORM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "driver/spi_master.h"
+#include "soc/gpio_struct.h"
+#include "driver/gpio.h"
+#include "esp_heap_caps.h"
+
+#include "pcd8544.h"
+
+// NO_DMA mode transaction data size is up to 32 bytes at a time.
+#define NO_DMA_TRANSACTION_DATA_SIZE 32
+
+// Number of SPI transactions that can be in flight.
+// Room for a whole frame of the largest display in NO_DMA chunks plus the
+// address commands.
+#define PCD8544_QUEUE_SIZE ((DISPLAY_PIXEL_MAX + NO_DMA_TRANSACTION_DATA_SIZE - 1) / NO_DMA_TRANSACTION_DATA_SIZE + 4)
+
+// SPI transaction timeout
+#define PCD8544_SPI_TIMEOUT (1000 / portTICK_PERIOD_MS)
+
+// Command bursts up to this size are sent with polling transmit
+#define PCD8544_POLLING_MAX_LEN 4
+
+// SPI HOST, only HSPI or VSPI
+#define PCD8544_HOST VSPI_HOST
+
+// D/C pin and level of a transaction, kept in the user field
+#define TRANS_DC_USER(pin, dc)  ((void *)(uintptr_t)(((uint32_t)(pin) << 1) | ((dc) & 1)))
+#define TRANS_DC_PIN(user)      ((uint32_t)(uintptr_t)(user) >> 1)
+#define TRANS_DC_LEVEL(user)    ((uint32_t)(uintptr_t)(user) & 1)
+
+// SPI transport state
+typedef struct spi_transport_t {
+  spi_device_handle_t spi;  // Handle for a device on a SPI bus
+  spi_transaction_t trans[PCD8544_QUEUE_SIZE];  // Transactions ring
+  uint8_t trans_next;       // Next free slot of the transactions ring
+  uint8_t in_flight;        // Number of queued transactions
+} spi_transport_t;
+
+static const char *TAG = "PCD8544_SPI";
+
+// Count a failed transaction
+static void
+count_error(spi_config_t *spicfg, esp_err_t err)
+{
+  if (err == ESP_ERR_TIMEOUT) {
+    spicfg->stats.timeouts++;
+  } else {
+    spicfg->stats.spi_errors++;
+  }
+}
+
+// This function is called (in irq context!) just before a transmission starts.
+// It will set the D/C line to the value indicated in the user field, the
+// user field also holds the D/C pin of the display.
+static void IRAM_ATTR
+spi_pre_transfer_callback(spi_transaction_t *t)
+{
+  gpio_set_level(TRANS_DC_PIN(t->user), TRANS_DC_LEVEL(t->user));
+}
+
+// Get the result of the oldest queued transaction.
+// A timed out transaction is still owned by the driver, its slot of the
+// ring can't be reused until it is done, so keep waiting for it.
+static void
+get_trans_result(spi_config_t *spicfg)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+  spi_transaction_t *rx;
+  esp_err_t err = spi_device_get_trans_result(spit->spi, &rx, PCD8544_SPI_TIMEOUT);
+  while (err == ESP_ERR_TIMEOUT) {
+    ESP_LOGI(TAG, "get_trans_result: spi_device_get_trans_result timeout, %d in flight", spit->in_flight);
+    count_error(spicfg, err);
+    err = spi_device_get_trans_result(spit->spi, &rx, PCD8544_SPI_TIMEOUT);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "get_trans_result: spi_device_get_trans_result error=%d", err);
+    count_error(spicfg, err);
+  }
+  spit->in_flight--;
+}
+
+// Wait until all queued transactions are done
+static void
+spi_wait(spi_config_t *spicfg)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+
+  if (spit->in_flight == 0) return;
+
+  int64_t start = esp_timer_get_time();
+  while (spit->in_flight > 0) {
+    get_trans_result(spicfg);
+  }
+  spicfg->stats.wait_us += esp_timer_get_time() - start;
+}
+
+// Collect the finished transactions without blocking.
+// Returns true while transactions are still in flight.
+static bool
+spi_busy(spi_config_t *spicfg)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+  spi_transaction_t *rx;
+
+  if (spit->in_flight == 0) return false;
+
+  while ((spit->in_flight > 0) && (spi_device_get_trans_result(spit->spi, &rx, 0) == ESP_OK)) {
+    spit->in_flight--;
+  }
+  return (spit->in_flight > 0);
+}
+
+// Set up a transaction, the pre-transfer callback sets the D/C line.
+// Up to 4 bytes are copied into the transaction.
+static void
+fill_trans(spi_config_t *spicfg, spi_transaction_t *tx, const uint8_t *data, int16_t len, int32_t dc)
+{
+  memset(tx, 0, sizeof(spi_transaction_t));
+  tx->length = len * 8;         // len is in bytes, transaction length is in bits.
+  tx->user = TRANS_DC_USER(spicfg->num_dc, dc);
+  if (len <= sizeof(tx->tx_data)) {
+    tx->flags = SPI_TRANS_USE_TXDATA;
+    memcpy(tx->tx_data, data, len);
+  } else {
+    tx->tx_buffer = data;       // Transmit data
+  }
+}
+
+// Send a short command burst with polling transmit, when nothing is queued.
+// Panels on a shared bus always queue, polling would wait for the others.
+// Returns false if the burst has to be queued.
+static bool
+polling_trans(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+  spi_transaction_t tx;
+
+  if ((dc != DC_CMD) || (len > PCD8544_POLLING_MAX_LEN) || (spit->in_flight > 0) || (spicfg->bus != NULL)) {
+    return false;
+  }
+  fill_trans(spicfg, &tx, data, len, dc);
+  esp_err_t err = spi_device_polling_transmit(spit->spi, &tx);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "polling_trans: spi_device_polling_transmit error=%d", err);
+    count_error(spicfg, err);
+    return true;
+  }
+  spicfg->stats.transactions++;
+  return true;
+}
+
+// Queue a transaction without waiting for completion.
+// The D/C line follows each transaction, so commands and data are queued
+// back to back. Up to 4 bytes are copied into the transaction, longer data
+// must stay valid until spi_wait().
+static void
+queue_trans(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+  esp_err_t err;
+
+  if (spit->in_flight == PCD8544_QUEUE_SIZE) {
+    get_trans_result(spicfg);
+  }
+
+  // the slot is taken only once the driver accepted the transaction
+  spi_transaction_t *tx = &spit->trans[spit->trans_next];
+  fill_trans(spicfg, tx, data, len, dc);
+  err = spi_device_queue_trans(spit->spi, tx, PCD8544_SPI_TIMEOUT);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "queue_trans: spi_device_queue_trans error=%d", err);
+    count_error(spicfg, err);
+    return;
+  }
+  spit->trans_next = (spit->trans_next + 1) % PCD8544_QUEUE_SIZE;
+  spit->in_flight++;
+  spicfg->stats.transactions++;
+}
+
+// Send buffer data to the display. Returns once the data is queued.
+// NOTE: NO_DMA mode can transmit up to 32 bytes at a time. The chunks are
+// queued back to back, so the next chunk is ready when one is done.
+static void
+spi_send(spi_config_t *spicfg, const uint8_t *data, int16_t len, int32_t dc)
+{
+  if (polling_trans(spicfg, data, len, dc)) {
+    return;
+  }
+  if (spicfg->dma_ch == 0) {
+    // NO_DMA mode
+    int16_t max_len, tx_len, left_len;
+    const uint8_t *cur_data = data;
+    max_len = NO_DMA_TRANSACTION_DATA_SIZE;
+    left_len = len;
+    // Split transmission with 32 bytes
+    while (left_len > 0) {
+      tx_len = (left_len > max_len) ? max_len : left_len;
+      queue_trans(spicfg, cur_data, tx_len, dc);
+      left_len -= tx_len;
+      cur_data += tx_len;
+    }
+  } else {
+    // Use DMA mode
+    queue_trans(spicfg, data, len, dc);
+  }
+}
+
+// Initialize the SPI manter
+static esp_err_t
+spi_init(spi_config_t *spicfg)
+{
+  spi_bus_config_t buscfg = {
+    .miso_io_num = spicfg->num_miso,
+    .mosi_io_num = spicfg->num_mosi,
+    .sclk_io_num = spicfg->num_sck,
+    .quadwp_io_num = -1,  // WP (Write Protect) signal, or -1 if not used.
+    .quadhd_io_num = -1   // HD (HolD) signal, or -1 if not used.
+  };
+  spi_device_interface_config_t devcfg = {
+    .clock_speed_hz = spicfg->spi_freq,
+    .mode = spicfg->spi_mode,
+    .spics_io_num = spicfg->num_cs,
+    .queue_size = PCD8544_QUEUE_SIZE,
+    .pre_cb = spi_pre_transfer_callback,  // set the D/C line
+    .post_cb = NULL
+  };
+  esp_err_t err;
+  spi_transport_t *spit;
+
+  spit = (spi_transport_t *)calloc(1, sizeof(spi_transport_t));
+  if (spit == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  spicfg->transport_data = spit;
+
+  // Initialize the SPI bus, unless a shared bus owns it
+  if (spicfg->bus == NULL) {
+    err = spi_bus_initialize(PCD8544_HOST, &buscfg, spicfg->dma_ch);
+    spicfg->require_reset = (err == ESP_ERR_INVALID_STATE) ? false : true;
+    if (err != ESP_OK) {
+      ESP_LOGI(TAG, "spi_init: spi_bus_initialize status=%d", err);
+    }
+  }
+
+  // Attach the LCD to the SPI bus
+  err = spi_bus_add_device(PCD8544_HOST, &devcfg, &spit->spi);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "spi_init: spi_bus_add_device status=%d", err);
+    return err;
+  }
+
+  // Initialize non-SPI GPIOs, the SPI driver drives CS
+  gpio_set_direction(spicfg->num_dc, GPIO_MODE_OUTPUT);
+  gpio_set_direction(spicfg->num_rst, GPIO_MODE_OUTPUT);
+  gpio_set_pull_mode(spicfg->num_cs, GPIO_PULLUP_ONLY);
+
+  return ESP_OK;
+}
+
+static void
+spi_deinit(spi_config_t *spicfg)
+{
+  spi_transport_t *spit = spicfg->transport_data;
+
+  if (spit == NULL) return;
+
+  if (spit->spi != NULL) {
+    spi_bus_remove_device(spit->spi);
+  }
+  free(spit);
+  spicfg->transport_data = NULL;
+}
+
+// Reset the display
+static void
+spi_reset(spi_config_t *spicfg)
+{
+  gpio_set_level(spicfg->num_rst, 1);
+  gpio_set_level(spicfg->num_rst, 0);
+  vTaskDelay(10 / portTICK_PERIOD_MS);
+  gpio_set_level(spicfg->num_rst, 1);
+}
+
+// Allocate a buffer that the SPI driver can transmit directly
+static uint8_t *
+spi_alloc(spi_config_t *spicfg, int16_t size)
+{
+  if (spicfg->dma_ch == 0) {
+    // NO DMA
+    return (uint8_t *)malloc(size);
+  } else {
+    // Use DMA_CH1 or DMA_CH2
+    return (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_DMA);
+  }
+}
+
+static void
+spi_free(spi_config_t *spicfg, uint8_t *buffer)
+{
+  // heap_caps_free() also releases memory allocated by malloc()
+  heap_caps_free(buffer);
+}
+
+// Initialize the SPI host of a shared bus
+static esp_err_t
+spi_bus_init(pcd8544_bus_t *bus)
+{
+  spi_bus_config_t buscfg = {
+    .miso_io_num = bus->num_miso,
+    .mosi_io_num = bus->num_mosi,
+    .sclk_io_num = bus->num_sck,
+    .quadwp_io_num = -1,
+    .quadhd_io_num = -1
+  };
+  esp_err_t err = spi_bus_initialize(PCD8544_HOST, &buscfg, bus->dma_ch);
+
+  if (err == ESP_ERR_INVALID_STATE) {
+    // already initialized by another user of the host
+    ESP_LOGI(TAG, "spi_bus_init: spi_bus_initialize status=%d", err);
+    return ESP_OK;
+  }
+  bus->owns_host = (err == ESP_OK);
+  return err;
+}
+
+static void
+spi_bus_deinit(pcd8544_bus_t *bus)
+{
+  if (bus->owns_host) {
+    spi_bus_free(PCD8544_HOST);
+    bus->owns_host = false;
+  }
+}
+
+const pcd8544_transport_t pcd8544_spi_transport = {
+  .name   = "spi",
+  .init   = spi_init,
+  .deinit = spi_deinit,
+  .reset  = spi_reset,
+  .send   = spi_send,
+  .wait   = spi_wait,
+  .busy   = spi_busy,
+  .alloc  = spi_alloc,
+  .free   = spi_free,
+  .queued_dc  = true,
+  .bus_init   = spi_bus_init,
+  .bus_deinit = spi_bus_deinit
+};
+
+#endif /* ESP_PLATFORM */
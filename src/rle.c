@@ -0,0 +1,253 @@
+// Run-length compressed images.
+// The decoder writes the runs straight into the frame buffer: a run that
+// lands on whole banks inside the clip rectangle is a memcpy or memset,
+// other runs are blitted. Nothing is buffered between the chunks except the
+// header and the state of the current run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rle.h"
+
+enum {
+  RLE_STATE_HEADER,
+  RLE_STATE_CONTROL,
+  RLE_STATE_LITERAL,
+  RLE_STATE_REPEAT,
+  RLE_STATE_DONE
+};
+
+// Bytes of a repeated run blitted at once
+#define RLE_REPEAT_CHUNK  32
+
+// Mark the banks of the frame buffer under n columns and rows pixel rows
+// at (dx, dy) in display coordinates
+static void
+rle_touch(rle_decoder_t *dec, int16_t dx, int16_t dy, int16_t n, int16_t rows)
+{
+  tinygrafx_t *tg = &dec->tg;
+  int16_t y0 = (dy > tg->clip_y0) ? dy : tg->clip_y0;
+  int16_t y1 = (dy + rows - 1 < tg->clip_y1) ? (dy + rows - 1) : tg->clip_y1;
+
+  if ((dx + n - 1 < tg->clip_x0) || (dx > tg->clip_x1) || (y0 > y1)) return;
+  for (int16_t bank = y0 / 8; (bank <= y1 / 8) && (bank < 8); bank++) {
+    dec->banks |= 1 << bank;
+  }
+}
+
+// Write n bytes of one bank of the image, from src or n times value
+static void
+rle_put(rle_decoder_t *dec, int16_t col, int16_t bank, const uint8_t *src, uint8_t value, int16_t n)
+{
+  tinygrafx_t *tg = &dec->tg;
+  int16_t rows = dec->height - bank * 8;
+  int16_t x = dec->x + col;
+  int16_t y = dec->y + bank * 8;
+  int16_t dx = x + tg->origin_x;
+  int16_t dy = y + tg->origin_y;
+
+  if (rows > 8) rows = 8;
+
+  // a run of zero bytes doesn't change the pixels with these operations,
+  // the runs of an XOR delta frame are mostly zero
+  if ((src == NULL) && (value == 0) &&
+      ((dec->rop == BLIT_OR) || (dec->rop == BLIT_XOR) || (dec->rop == BLIT_ERASE))) {
+    return;
+  }
+  rle_touch(dec, dx, dy, n, rows);
+
+  // whole bank of the frame buffer inside the clip rectangle
+  if ((dec->rop == BLIT_COPY) && (rows == 8) &&
+      (dy >= tg->clip_y0) && (dy + 7 <= tg->clip_y1) && ((dy & 0x07) == 0) &&
+      (dx >= tg->clip_x0) && (dx + n - 1 <= tg->clip_x1)) {
+    uint8_t *dst = tg->display_buffer + dx + (dy / 8) * tg->display_width;
+    if (src != NULL) {
+      memcpy(dst, src, n);
+    } else {
+      memset(dst, value, n);
+    }
+    return;
+  }
+
+  if (src != NULL) {
+    blit(tg, x, y, src, NULL, n, rows, dec->rop);
+    return;
+  }
+  uint8_t run[RLE_REPEAT_CHUNK];
+  memset(run, value, (n < RLE_REPEAT_CHUNK) ? n : RLE_REPEAT_CHUNK);
+  for (int16_t i = 0; i < n; i += RLE_REPEAT_CHUNK) {
+    int16_t len = (n - i < RLE_REPEAT_CHUNK) ? (n - i) : RLE_REPEAT_CHUNK;
+    blit(tg, x + i, y, run, NULL, len, rows, dec->rop);
+  }
+}
+
+// Write a run, split at the ends of the banks
+static void
+rle_emit(rle_decoder_t *dec, const uint8_t *src, uint8_t value, int16_t n)
+{
+  while (n > 0) {
+    int16_t col = dec->pos % dec->width;
+    int16_t bank = dec->pos / dec->width;
+    int16_t len = (n < dec->width - col) ? n : (dec->width - col);
+
+    rle_put(dec, col, bank, src, value, len);
+    dec->pos += len;
+    n -= len;
+    if (src != NULL) src += len;
+  }
+}
+
+void
+rle_begin(rle_decoder_t *dec, const tinygrafx_t *tg, int16_t x, int16_t y, int16_t rop)
+{
+  memset(dec, 0, sizeof(rle_decoder_t));
+  dec->tg = *tg;
+  dec->x = x;
+  dec->y = y;
+  dec->rop = rop;
+  dec->state = RLE_STATE_HEADER;
+}
+
+// Decode the next chunk. Returns ESP_ERR_INVALID_ARG on a bad header and
+// ESP_ERR_INVALID_SIZE if the runs overflow the image.
+esp_err_t
+rle_feed(rle_decoder_t *dec, const uint8_t *data, int32_t length)
+{
+  const uint8_t *end = data + length;
+
+  while (data < end) {
+    switch (dec->state) {
+      case RLE_STATE_HEADER:
+        dec->header[dec->header_len++] = *data++;
+        if (dec->header_len < RLE_HEADER_SIZE) break;
+        if ((dec->header[0] != RLE_MAGIC) || (dec->header[1] == 0) || (dec->header[2] == 0)) {
+          return ESP_ERR_INVALID_ARG;
+        }
+        dec->width = dec->header[1];
+        dec->height = dec->header[2];
+        dec->total = (int32_t)dec->width * ((dec->height + 7) / 8);
+        dec->state = RLE_STATE_CONTROL;
+        break;
+
+      case RLE_STATE_CONTROL: {
+        uint8_t c = *data++;
+        if (c < 0x80) {
+          dec->count = c + 1;
+          dec->state = RLE_STATE_LITERAL;
+        } else {
+          dec->count = (c & 0x7F) + RLE_REPEAT_MIN;
+          dec->state = RLE_STATE_REPEAT;
+        }
+        if (dec->pos + dec->count > dec->total) {
+          return ESP_ERR_INVALID_SIZE;
+        }
+        break;
+      }
+
+      case RLE_STATE_LITERAL: {
+        int16_t n = (end - data < dec->count) ? (end - data) : dec->count;
+        rle_emit(dec, data, 0, n);
+        data += n;
+        dec->count -= n;
+        if (dec->count == 0) {
+          dec->state = (dec->pos == dec->total) ? RLE_STATE_DONE : RLE_STATE_CONTROL;
+        }
+        break;
+      }
+
+      case RLE_STATE_REPEAT:
+        rle_emit(dec, NULL, *data++, dec->count);
+        dec->count = 0;
+        dec->state = (dec->pos == dec->total) ? RLE_STATE_DONE : RLE_STATE_CONTROL;
+        break;
+
+      default:
+        // data after the end of the image
+        return ESP_ERR_INVALID_SIZE;
+    }
+  }
+  return ESP_OK;
+}
+
+bool
+rle_done(const rle_decoder_t *dec)
+{
+  return dec->state == RLE_STATE_DONE;
+}
+
+esp_err_t
+rle_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *data, int32_t length, int16_t rop)
+{
+  rle_decoder_t dec;
+
+  rle_begin(&dec, tg, x, y, rop);
+  esp_err_t err = rle_feed(&dec, data, length);
+  if ((err == ESP_OK) && !rle_done(&dec)) {
+    err = ESP_ERR_INVALID_SIZE;
+  }
+  return err;
+}
+
+esp_err_t
+rle_size(const uint8_t *data, int32_t length, int16_t *width, int16_t *height)
+{
+  if ((length < RLE_HEADER_SIZE) || (data[0] != RLE_MAGIC) || (data[1] == 0) || (data[2] == 0)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *width = data[1];
+  *height = data[2];
+  return ESP_OK;
+}
+
+// Repeated bytes from bitmap[i], up to RLE_REPEAT_MAX
+static int16_t
+rle_repeat(const uint8_t *bitmap, int32_t i, int32_t total)
+{
+  int16_t n = 1;
+
+  while ((i + n < total) && (n < RLE_REPEAT_MAX) && (bitmap[i + n] == bitmap[i])) {
+    n++;
+  }
+  return n;
+}
+
+int32_t
+rle_encode(const uint8_t *bitmap, int16_t width, int16_t height, uint8_t *out, int32_t size)
+{
+  int32_t total = (int32_t)width * ((height + 7) / 8);
+  int32_t n = 0;
+  int32_t i = 0;
+
+  if ((width <= 0) || (width > 255) || (height <= 0) || (height > 255) || (size < RLE_HEADER_SIZE)) {
+    return -1;
+  }
+  out[n++] = RLE_MAGIC;
+  out[n++] = width;
+  out[n++] = height;
+
+  while (i < total) {
+    int16_t repeat = rle_repeat(bitmap, i, total);
+
+    if (repeat >= RLE_REPEAT_MIN) {
+      if (n + 2 > size) return -1;
+      out[n++] = 0x80 | (repeat - RLE_REPEAT_MIN);
+      out[n++] = bitmap[i];
+      i += repeat;
+      continue;
+    }
+
+    // literal bytes up to the next repeated run
+    int32_t start = i;
+    while ((i < total) && (i - start < RLE_LITERAL_MAX)) {
+      if (rle_repeat(bitmap, i, total) >= RLE_REPEAT_MIN) break;
+      i++;
+    }
+    int32_t len = i - start;
+    if (n + 1 + len > size) return -1;
+    out[n++] = len - 1;
+    memcpy(out + n, bitmap + start, len);
+    n += len;
+  }
+  return n;
+}
@@ -0,0 +1,58 @@
+#ifndef RLEH_
+#define RLEH_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_compat.h"
+#include "tiny_grafx.h"
+
+// Run-length compressed 1bpp image in the page layout.
+//
+//   'R', width, height, runs...
+//
+// The runs expand to the (height + 7) / 8 banks of width bytes, bank after
+// bank. A control byte 0x00-0x7F is followed by 1-128 literal bytes, a
+// control byte 0x80-0xFF is followed by a byte repeated 3-130 times.
+#define RLE_MAGIC           'R'
+#define RLE_HEADER_SIZE     3
+#define RLE_LITERAL_MAX     128
+#define RLE_REPEAT_MIN      3
+#define RLE_REPEAT_MAX      (0x7F + RLE_REPEAT_MIN)
+
+// Largest encoded size of a width x height image
+#define RLE_ENCODED_MAX(width, height) \
+  (RLE_HEADER_SIZE + (width) * (((height) + 7) / 8) + ((width) * (((height) + 7) / 8) + RLE_LITERAL_MAX - 1) / RLE_LITERAL_MAX)
+
+// Streaming decoder, the image is decoded straight into the frame buffer
+// as the data arrives in chunks of any size.
+typedef struct rle_decoder_t {
+  tinygrafx_t tg;           // destination, may be updated between the chunks
+  int16_t x;                // top left of the image
+  int16_t y;
+  int16_t rop;              // raster operation, see blit
+  int16_t width;            // image size, from the header
+  int16_t height;
+  int32_t pos;              // bytes of the image decoded
+  int32_t total;            // bytes of the image
+  int16_t count;            // bytes left in the current run
+  uint8_t banks;            // banks of the frame buffer changed, a bit per bank
+  uint8_t state;
+  uint8_t header[RLE_HEADER_SIZE];
+  int16_t header_len;
+} rle_decoder_t;
+
+void rle_begin(rle_decoder_t *dec, const tinygrafx_t *tg, int16_t x, int16_t y, int16_t rop);
+esp_err_t rle_feed(rle_decoder_t *dec, const uint8_t *data, int32_t length);
+bool rle_done(const rle_decoder_t *dec);
+
+// Decode a whole image
+esp_err_t rle_draw(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *data, int32_t length, int16_t rop);
+
+// Size of the image from the header
+esp_err_t rle_size(const uint8_t *data, int32_t length, int16_t *width, int16_t *height);
+
+// Compress a bitmap in the page layout, returns the encoded size or -1 if
+// it doesn't fit in "size" bytes. RLE_ENCODED_MAX bytes are always enough.
+int32_t rle_encode(const uint8_t *bitmap, int16_t width, int16_t height, uint8_t *out, int32_t size);
+
+#endif /* RLEH_ */
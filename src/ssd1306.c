@@ -0,0 +1,80 @@
+// SSD1306 controller driver, 128x64 OLED on the 4-wire SPI interface.
+// The display RAM has the page layout of the frame buffer. The frames are
+// sent in horizontal addressing mode with a column and page window, the
+// strip of the diff flush in vertical addressing mode, so the window limits
+// the strip to the bounding box of the changes.
+
+#include <stdio.h>
+
+#include "pcd8544.h"
+#include "ssd1306.h"
+
+// ssd1306 init commands, 128x64 with the internal charge pump
+DRAM_ATTR static const uint8_t ssd1306_init_cmds[] = {
+  SSD1306_DISPLAYOFF,
+  SSD1306_SETCLOCKDIV, 0x80,                    // default oscillator and divide ratio
+  SSD1306_SETMULTIPLEX, SSD1306_DISPLAY_HEIGHT - 1,
+  SSD1306_SETDISPLAYOFFSET, 0x00,
+  (SSD1306_SETSTARTLINE|0x00),
+  SSD1306_CHARGEPUMP, 0x14,                     // enable the charge pump
+  SSD1306_MEMORYMODE, SSD1306_HORIZONTAL,
+  (SSD1306_SEGREMAP|0x01),                      // column 127 is SEG0
+  SSD1306_COMSCANDEC,                           // scan from COM63, bank 0 on top
+  SSD1306_SETCOMPINS, 0x12,                     // alternative COM pins
+  SSD1306_SETCONTRAST, 0xCF,
+  SSD1306_SETPRECHARGE, 0xF1,
+  SSD1306_SETVCOMDETECT, 0x40,
+  SSD1306_DEACTIVATE_SCROLL,
+  SSD1306_DISPLAYALLON_RESUME,                  // show the RAM
+  SSD1306_NORMALDISPLAY,
+  SSD1306_DISPLAYON
+};
+
+// whole RAM window, column 0 of bank 0. use horizontal addressing mode.
+DRAM_ATTR static const uint8_t ssd1306_address_init[] = {
+  SSD1306_MEMORYMODE, SSD1306_HORIZONTAL,
+  SSD1306_COLUMNADDR, 0, SSD1306_DISPLAY_WIDTH - 1,
+  SSD1306_PAGEADDR, 0, SSD1306_DISPLAY_HEIGHT / 8 - 1
+};
+
+// Set the RAM window x0-x1, b0-b1, the address starts at x0, b0.
+// Sent as short commands, so the transport copies them.
+static void
+ssd1306_address(spi_config_t *spicfg, int16_t x0, int16_t b0, int16_t x1, int16_t b1, bool vertical)
+{
+  uint8_t mode[] = {
+    SSD1306_MEMORYMODE,
+    (vertical ? SSD1306_VERTICAL : SSD1306_HORIZONTAL)
+  };
+  uint8_t columns[] = { SSD1306_COLUMNADDR, x0, x1 };
+  uint8_t pages[] = { SSD1306_PAGEADDR, b0, b1 };
+
+  pcd8544_send_cmds(spicfg, mode, sizeof(mode));
+  pcd8544_send_cmds(spicfg, columns, sizeof(columns));
+  pcd8544_send_cmds(spicfg, pages, sizeof(pages));
+}
+
+// Contrast 0-127 scaled to the 0-255 of the controller
+static void
+ssd1306_contrast(spi_config_t *spicfg, uint8_t contrast)
+{
+  uint8_t cmds[] = {
+    SSD1306_SETCONTRAST,
+    ((contrast << 1) | (contrast >> 6))
+  };
+  pcd8544_send_cmds(spicfg, cmds, sizeof(cmds));
+}
+
+const display_driver_t ssd1306_driver = {
+  .name       = "SSD1306",
+  .width      = SSD1306_DISPLAY_WIDTH,
+  .height     = SSD1306_DISPLAY_HEIGHT,
+  .init_cmds  = ssd1306_init_cmds,
+  .init_len   = sizeof(ssd1306_init_cmds),
+  .frame_cmds = ssd1306_address_init,
+  .frame_len  = sizeof(ssd1306_address_init),
+  .run_cost   = SSD1306_DIFF_RUN_COST,
+  .window     = true,
+  .address    = ssd1306_address,
+  .contrast   = ssd1306_contrast
+};
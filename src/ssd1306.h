@@ -0,0 +1,46 @@
+#ifndef SSD1306H_
+#define SSD1306H_
+
+// SSD1306 fundamental commands
+#define SSD1306_SETCONTRAST         0x81
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY       0xA6
+#define SSD1306_INVERTDISPLAY       0xA7
+#define SSD1306_DISPLAYOFF          0xAE
+#define SSD1306_DISPLAYON           0xAF
+
+// SSD1306 addressing commands
+#define SSD1306_MEMORYMODE          0x20
+#define SSD1306_COLUMNADDR          0x21
+#define SSD1306_PAGEADDR            0x22
+#define SSD1306_SETLOWCOLUMN        0x00
+#define SSD1306_SETHIGHCOLUMN       0x10
+#define SSD1306_SETPAGE             0xB0
+
+// SSD1306 memory addressing modes
+#define SSD1306_HORIZONTAL          0x00
+#define SSD1306_VERTICAL            0x01
+#define SSD1306_PAGE                0x02
+
+// SSD1306 hardware configuration and timing commands
+#define SSD1306_SETSTARTLINE        0x40
+#define SSD1306_SEGREMAP            0xA0
+#define SSD1306_SETMULTIPLEX        0xA8
+#define SSD1306_COMSCANDEC          0xC8
+#define SSD1306_SETDISPLAYOFFSET    0xD3
+#define SSD1306_SETCOMPINS          0xDA
+#define SSD1306_SETCLOCKDIV         0xD5
+#define SSD1306_SETPRECHARGE        0xD9
+#define SSD1306_SETVCOMDETECT       0xDB
+#define SSD1306_CHARGEPUMP          0x8D
+#define SSD1306_DEACTIVATE_SCROLL   0x2E
+
+// SSD1306 display config
+#define SSD1306_DISPLAY_WIDTH   128
+#define SSD1306_DISPLAY_HEIGHT  64
+
+// Diff flush cost of re-addressing the RAM, in bytes.
+// (8 command bytes plus the extra command/data transactions)
+#define SSD1306_DIFF_RUN_COST   14
+
+#endif /* SSD1306H_ */
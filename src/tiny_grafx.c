@@ -33,16 +33,17 @@
 
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-#include "esp_err.h"
-#include "esp_log.h"
+#include "esp_compat.h"
 static const char *TAG = "TINY_GRAFX";
 
-// 8x8 monochrome bitmap fonts from font8x8_basic.h by dhepper/font8x8
-// https://github.com/dhepper/font8x8
-#include "font8x8_basic.h"
-
 #include "tiny_grafx.h"
+#include "font.h"
+
+// Glyph of the 8x8 font, 8 columns in the page layout
+#define FONT8X8_GLYPH(c)  (font_8x8.bitmap + (c) * 8)
 
 // manipulate graphics
 //
@@ -51,21 +52,95 @@ static const char *TAG = "TINY_GRAFX";
 //
 
 
+// Clip rectangle, intersected with the display. An empty rectangle clips
+// everything.
+void 
+set_clip(tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h) 
+{
+  int32_t x1 = (int32_t)x + w - 1;
+  int32_t y1 = (int32_t)y + h - 1;
+
+  tg->clip_x0 = (x < 0) ? 0 : x;
+  tg->clip_y0 = (y < 0) ? 0 : y;
+  tg->clip_x1 = (x1 >= tg->display_width) ? (tg->display_width - 1) : x1;
+  tg->clip_y1 = (y1 >= tg->display_height) ? (tg->display_height - 1) : y1;
+  if ((tg->clip_x1 < tg->clip_x0) || (tg->clip_y1 < tg->clip_y0)) {
+    tg->clip_x0 = tg->clip_y0 = 0;
+    tg->clip_x1 = tg->clip_y1 = -1;
+  }
+}
+
 void 
-buffer_clear(tinygrafx_t tg) 
+reset_clip(tinygrafx_t *tg) 
 {
-  memset(tg.display_buffer, 0x00, tg.display_pixel);
+  set_clip(tg, 0, 0, tg->display_width, tg->display_height);
+}
+
+void 
+set_origin(tinygrafx_t *tg, int16_t x, int16_t y) 
+{
+  tg->origin_x = x;
+  tg->origin_y = y;
+}
+
+// Geometry of the frame buffer in the raster core.
+// In a build for a fixed panel geometry (TINYGRAFX_FIXED_WIDTH and
+// TINYGRAFX_FIXED_HEIGHT) the core runs with constants for a frame buffer
+// of that size, so the index math x + (y / 8) * width folds into shifts and
+// adds. Other frame buffers, e.g. the canvases, run the same core with the
+// size of the config. The core functions are always inlined for this.
+#define CORE static inline __attribute__((always_inline))
+
+#ifdef TINYGRAFX_FIXED_WIDTH
+#define WITH_GEOMETRY(tg, call) \
+  do { \
+    if (((tg)->display_width == TINYGRAFX_FIXED_WIDTH) && ((tg)->display_height == TINYGRAFX_FIXED_HEIGHT)) { \
+      const int16_t width = TINYGRAFX_FIXED_WIDTH, height = TINYGRAFX_FIXED_HEIGHT; \
+      (void)width; (void)height; \
+      call; \
+    } \
+    else { \
+      const int16_t width = (tg)->display_width, height = (tg)->display_height; \
+      (void)width; (void)height; \
+      call; \
+    } \
+  } while (0)
+#else
+#define WITH_GEOMETRY(tg, call) \
+  do { \
+    const int16_t width = (tg)->display_width, height = (tg)->display_height; \
+    (void)width; (void)height; \
+    call; \
+  } while (0)
+#endif
+
+// Write a pixel inside the clip rectangle, display coordinates
+CORE void 
+put_pixel(uint8_t *buffer, int16_t width, int16_t x, int16_t y, int16_t color) 
+{
+  uint8_t *data = &buffer[x + (y / 8) * width];
+  switch (color) {
+    case WHITE: *data |=  (1 << (y & 7)); break;
+    case BLACK: *data &= ~(1 << (y & 7)); break;
+    case INVERT:*data ^=  (1 << (y & 7)); break;
+  }
 }
 
 void 
-buffer_read(tinygrafx_t tg, uint8_t *data, int16_t size) 
+buffer_clear(const tinygrafx_t *tg) 
+{
+  memset(tg->display_buffer, 0x00, tg->display_pixel);
+}
+
+void 
+buffer_read(const tinygrafx_t *tg, uint8_t *data, int16_t size) 
 {
   if (data == NULL) {
     ESP_LOGI(TAG, "buffer_read: data NULL error");
   }
-  if (size == tg.display_pixel) {
-    for (int16_t i=0; i<tg.display_pixel; i++) {
-      data[i] = tg.display_buffer[i];
+  if (size == tg->display_pixel) {
+    for (int16_t i=0; i<tg->display_pixel; i++) {
+      data[i] = tg->display_buffer[i];
     }
   }
   else {
@@ -73,110 +148,158 @@ buffer_read(tinygrafx_t tg, uint8_t *data, int16_t size)
   }
 }
 
-void 
-set_pixel(tinygrafx_t tg, int16_t x, int16_t y, uint16_t color) 
+// Write a pixel if it is inside the clip rectangle, display coordinates
+CORE void 
+plot_pixel(const tinygrafx_t *tg, int16_t width, int16_t x, int16_t y, int16_t color) 
 {
-  if ((x >= 0) && (x < tg.display_width) && (y >= 0) && (y < tg.display_height)) {
-    switch (color) {
-      case WHITE: tg.display_buffer[x + (y / 8) * tg.display_width] |=  (1 << (y & 7)); break;
-      case BLACK: tg.display_buffer[x + (y / 8) * tg.display_width] &= ~(1 << (y & 7)); break;
-      case INVERT:tg.display_buffer[x + (y / 8) * tg.display_width] ^=  (1 << (y & 7)); break;
-    }
+  if ((x >= tg->clip_x0) && (x <= tg->clip_x1) && (y >= tg->clip_y0) && (y <= tg->clip_y1)) {
+    put_pixel(tg->display_buffer, width, x, y, color);
   } 
 }
 
-int16_t 
-get_pixel(tinygrafx_t tg, int16_t x, int16_t y) 
+void 
+set_pixel(const tinygrafx_t *tg, int16_t x, int16_t y, uint16_t color) 
+{
+  WITH_GEOMETRY(tg, plot_pixel(tg, width, x + tg->origin_x, y + tg->origin_y, color));
+}
+
+CORE int16_t 
+read_pixel(const tinygrafx_t *tg, int16_t width, int16_t height, int16_t x, int16_t y) 
 {
-  if ((x >= 0) && (x < tg.display_width) && (y >= 0) && (y < tg.display_height)) {
-    return (tg.display_buffer[x + (y / 8) * tg.display_width] >> (y % 8)) & 0x1;
+  if ((x >= 0) && (x < width) && (y >= 0) && (y < height)) {
+    return (tg->display_buffer[x + (y / 8) * width] >> (y % 8)) & 0x1;
   }
   else {
     return 0;
   }
 }
 
-void 
-draw_line(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t color) 
+int16_t 
+get_pixel(const tinygrafx_t *tg, int16_t x, int16_t y) 
+{
+  int16_t pixel;
+
+  WITH_GEOMETRY(tg, pixel = read_pixel(tg, width, height, x + tg->origin_x, y + tg->origin_y));
+  return pixel;
+}
+
+// The line is clipped before rasterizing. The Bresenham state of the first
+// visible step is computed directly, so the pixels drawn are those of the
+// unclipped line, and a line outside the clip rectangle costs nothing.
+CORE void 
+line_core(const tinygrafx_t *tg, int16_t width, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t color) 
 {
-  int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+  int32_t ax0 = x0 + tg->origin_x, ay0 = y0 + tg->origin_y;
+  int32_t ax1 = x1 + tg->origin_x, ay1 = y1 + tg->origin_y;
+  int32_t min_x = tg->clip_x0, max_x = tg->clip_x1;
+  int32_t min_y = tg->clip_y0, max_y = tg->clip_y1;
+  int32_t t;
+
+  if (((ax0 < min_x) && (ax1 < min_x)) || ((ax0 > max_x) && (ax1 > max_x))) return;
+  if (((ay0 < min_y) && (ay1 < min_y)) || ((ay0 > max_y) && (ay1 > max_y))) return;
 
+  // x is the major axis
+  int16_t steep = abs(ay1 - ay0) > abs(ax1 - ax0);
   if (steep) {
-    swap_int16_t(x0, y0);
-    swap_int16_t(x1, y1);
+    t = ax0; ax0 = ay0; ay0 = t;
+    t = ax1; ax1 = ay1; ay1 = t;
+    t = min_x; min_x = min_y; min_y = t;
+    t = max_x; max_x = max_y; max_y = t;
   }
-  if (x0 > x1) {
-    swap_int16_t(x0, x1);
-    swap_int16_t(y0, y1);
+  if (ax0 > ax1) {
+    t = ax0; ax0 = ax1; ax1 = t;
+    t = ay0; ay0 = ay1; ay1 = t;
   }
 
-  int16_t dx = x1 - x0;
-  int16_t dy = abs(y1 - y0);
-  int16_t err = dx / 2;
-  int16_t ystep;
-
-  if (y0 < y1) {
-    ystep = 1;
+  int32_t dx = ax1 - ax0;
+  int32_t dy = abs(ay1 - ay0);
+  int32_t half = dx / 2;
+  int32_t ystep = (ay0 < ay1) ? 1 : -1;
+
+  // steps k = x - ax0 inside the clip rectangle. After k steps y moved
+  // n(k) = ceil((k * dy - dx / 2) / dx) pixels, at least 0.
+  int32_t k0 = (min_x > ax0) ? (min_x - ax0) : 0;
+  int32_t k1 = (max_x < ax1) ? (max_x - ax0) : dx;
+  if (dy > 0) {
+    int32_t n_lo = (ystep > 0) ? (min_y - ay0) : (ay0 - max_y);
+    int32_t n_hi = (ystep > 0) ? (max_y - ay0) : (ay0 - min_y);
+    if (n_hi < 0) return;
+    if (n_lo > 0) {
+      int32_t k = ((int64_t)(n_lo - 1) * dx + half) / dy + 1;
+      if (k > k0) k0 = k;
+    }
+    int64_t k = ((int64_t)n_hi * dx + half) / dy;
+    if (k < k1) k1 = k;
   }
-  else {
-    ystep = -1;
+  else if ((ay0 < min_y) || (ay0 > max_y)) {
+    return;
   }
+  if (k0 > k1) return;
+
+  int64_t moved = (int64_t)k0 * dy - half;
+  int32_t n = (moved > 0) ? (moved + dx - 1) / dx : 0;
+  int32_t err = half - (int64_t)k0 * dy + (int64_t)n * dx;
+  int32_t y = ay0 + ystep * n;
 
-  for (; x0 <= x1; x0++) {
+  for (int32_t x = ax0 + k0; x <= ax0 + k1; x++) {
     if (steep) {
-      set_pixel(tg, y0, x0, color);
+      put_pixel(tg->display_buffer, width, y, x, color);
     }
     else {
-      set_pixel(tg, x0, y0, color);
+      put_pixel(tg->display_buffer, width, x, y, color);
     }
     err -= dy;
     if (err < 0) {
-      y0 += ystep;
+      y += ystep;
       err += dx;
     }
   }
 }
 
 void 
-draw_vertical_line(tinygrafx_t tg, int16_t x, int16_t y, int16_t h, int16_t color) 
+draw_line(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t color) 
 {
-  if (y < 0) {
-    h += y;
-    y = 0;
-  }
+  WITH_GEOMETRY(tg, line_core(tg, width, x0, y0, x1, y1, color));
+}
 
-  if ((y + h) > tg.display_height) {
-    h = tg.display_height - y; 
+// Apply the bit mask to a byte of the frame buffer
+static inline void 
+apply_mask(uint8_t *data, uint8_t mask, int16_t color) 
+{
+  switch (color) {
+    case WHITE: *data |=  mask; break;
+    case BLACK: *data &= ~mask; break;
+    case INVERT:*data ^=  mask; break;
   }
+}
 
-  if (h <= 0) return;
-  
-  for (int16_t h1 = 0; h1 < h; h1++) {
-    set_pixel(tg, x, y + h1, color);
+// Apply the bit mask to a row of bytes in a bank
+static inline void 
+apply_mask_row(uint8_t *data, int16_t w, uint8_t mask, int16_t color) 
+{
+  if (mask == 0xFF && color != INVERT) {
+    memset(data, (color == WHITE) ? 0xFF : 0x00, w);
+    return;
+  }
+  for (int16_t i = 0; i < w; i++) {
+    apply_mask(&data[i], mask, color);
   }
 }
 
 void 
-draw_horizontal_line(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t color) 
+draw_vertical_line(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t h, int16_t color) 
 {
-  if (x < 0) {
-    w += x;
-    x = 0;
-  }
-
-  if ((x + w) > tg.display_width) {
-    w = tg.display_width - x; 
-  }
+  draw_fill_rect(tg, x, y, 1, h, color);
+}
 
-  if (w <= 0) return;
-  
-  for (int16_t w1 = 0; w1 < w; w1++) {
-    set_pixel(tg, x + w1, y, color);
-  }
+void 
+draw_horizontal_line(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t color) 
+{
+  draw_fill_rect(tg, x, y, w, 1, color);
 }
 
 void 
-draw_rect(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color) 
+draw_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color) 
 {
   draw_horizontal_line(tg, x, y, w, color);
   draw_horizontal_line(tg, x, y + h - 1, w, color);
@@ -184,25 +307,80 @@ draw_rect(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t co
   draw_vertical_line(tg, x + w - 1, y, h, color);
 }
 
-void 
-draw_fill_rect(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color) 
+// Fill the rectangle a bank at a time, display coordinates.
+// Each column of a bank is one byte, masked at the top and bottom edges.
+CORE void 
+fill_rect_core(const tinygrafx_t *tg, int16_t width, int32_t x, int32_t y, int32_t w, int32_t h, int16_t color) 
 {
-  for (int16_t w1 = 0; w1 < w; w1++) {
-    draw_vertical_line(tg, x + w1, y, h, color);
+  if (x < tg->clip_x0) {
+    w -= tg->clip_x0 - x;
+    x = tg->clip_x0;
+  }
+  if (y < tg->clip_y0) {
+    h -= tg->clip_y0 - y;
+    y = tg->clip_y0;
+  }
+  if ((x + w - 1) > tg->clip_x1) {
+    w = tg->clip_x1 - x + 1;
+  }
+  if ((y + h - 1) > tg->clip_y1) {
+    h = tg->clip_y1 - y + 1;
+  }
+  if ((w <= 0) || (h <= 0)) return;
+
+  int16_t y_end = y + h - 1;
+  int16_t bank = y / 8;
+  int16_t bank_end = y_end / 8;
+  uint8_t top_mask = 0xFF << (y & 7);
+  uint8_t bottom_mask = 0xFF >> (7 - (y_end & 7));
+
+  if (bank == bank_end) {
+    apply_mask_row(tg->display_buffer + x + bank * width, w, top_mask & bottom_mask, color);
+    return;
+  }
+
+  apply_mask_row(tg->display_buffer + x + bank * width, w, top_mask, color);
+  if (w == width) {
+    // full width, the middle banks are contiguous
+    apply_mask_row(tg->display_buffer + (bank + 1) * width, 
+                   (bank_end - bank - 1) * width, 0xFF, color);
+  }
+  else {
+    for (int16_t b = bank + 1; b < bank_end; b++) {
+      apply_mask_row(tg->display_buffer + x + b * width, w, 0xFF, color);
+    }
   }
+  apply_mask_row(tg->display_buffer + x + bank_end * width, w, bottom_mask, color);
+}
+
+static void 
+fill_rect_clipped(const tinygrafx_t *tg, int32_t x, int32_t y, int32_t w, int32_t h, int16_t color) 
+{
+  WITH_GEOMETRY(tg, fill_rect_core(tg, width, x, y, w, h, color));
 }
 
 void 
-draw_circle(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t r, int16_t color) 
+draw_fill_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color) 
+{
+  fill_rect_clipped(tg, (int32_t)x + tg->origin_x, (int32_t)y + tg->origin_y, w, h, color);
+}
+
+// x0, y0 in display coordinates
+CORE void 
+circle_core(const tinygrafx_t *tg, int16_t width, int16_t x0, int16_t y0, int16_t r, int16_t color) 
 {
   int16_t x = 0;
   int16_t y = r;
 	int16_t dp = 1 - r;
 
-  set_pixel(tg, x0, y0 + r, color);
-  set_pixel(tg, x0, y0 - r, color);
-  set_pixel(tg, x0 + r, y0, color);
-  set_pixel(tg, x0 - r, y0, color);
+  // r = 0 still plots the pixels next to the center
+  if ((x0 + r + 1 < tg->clip_x0) || (x0 - r - 1 > tg->clip_x1)) return;
+  if ((y0 + r + 1 < tg->clip_y0) || (y0 - r - 1 > tg->clip_y1)) return;
+
+  plot_pixel(tg, width, x0, y0 + r, color);
+  plot_pixel(tg, width, x0, y0 - r, color);
+  plot_pixel(tg, width, x0 + r, y0, color);
+  plot_pixel(tg, width, x0 - r, y0, color);
 
 	do {
 		if (dp < 0) {
@@ -212,89 +390,610 @@ draw_circle(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t r, int16_t color)
 			dp = dp + 2 * (++x) - 2 * (--y) + 5;
     }
 
-		set_pixel(tg, x0 + x, y0 + y, color);     //For the 8 octants
-		set_pixel(tg, x0 - x, y0 + y, color);
-		set_pixel(tg, x0 + x, y0 - y, color);
-		set_pixel(tg, x0 - x, y0 - y, color);
-		set_pixel(tg, x0 + y, y0 + x, color);
-		set_pixel(tg, x0 - y, y0 + x, color);
-		set_pixel(tg, x0 + y, y0 - x, color);
-		set_pixel(tg, x0 - y, y0 - x, color);
+		plot_pixel(tg, width, x0 + x, y0 + y, color);     //For the 8 octants
+		plot_pixel(tg, width, x0 - x, y0 + y, color);
+		plot_pixel(tg, width, x0 + x, y0 - y, color);
+		plot_pixel(tg, width, x0 - x, y0 - y, color);
+		plot_pixel(tg, width, x0 + y, y0 + x, color);
+		plot_pixel(tg, width, x0 - y, y0 + x, color);
+		plot_pixel(tg, width, x0 + y, y0 - x, color);
+		plot_pixel(tg, width, x0 - y, y0 - x, color);
 
 	} while (x < y);
 }
 
 void 
-draw_fill_circle(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t r, int16_t color) 
+draw_circle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t r, int16_t color) 
 {
-  int16_t x = 0;
-  int16_t y = r;
-	int16_t dp = 1 - r;
-  
-  draw_horizontal_line(tg, x0 - r, y0, 2 * r, color);
+  WITH_GEOMETRY(tg, circle_core(tg, width, x0 + tg->origin_x, y0 + tg->origin_y, r, color));
+}
 
-	do {
-		if (dp < 0) {
-			dp = dp + 2 * (++x) + 3;
-    }
-    else {
-			dp = dp + 2 * (++x) - 2 * (--y) + 5;
+// Span rasterizer for polygons.
+// The polygon is emitted as horizontal spans, at most one call per span.
+// The spans of a bank are collected as one byte per column (the rows covered
+// in the bank), then each byte of the frame buffer is written once. Spans
+// overlapping in the same bank are merged, so INVERT inverts every pixel of
+// the polygon exactly once.
+typedef struct span_acc_t {
+  const tinygrafx_t *tg;
+  int16_t color;
+  int16_t bank;             // bank being collected, -1 = none
+  int16_t x0, x1;           // columns touched in the bank
+  uint8_t mask[TINYGRAFX_MAX_WIDTH];
+} span_acc_t;
+
+static void 
+span_begin(span_acc_t *acc, const tinygrafx_t *tg, int16_t color) 
+{
+  acc->tg = tg;
+  acc->color = color;
+  acc->bank = -1;
+  acc->x0 = TINYGRAFX_MAX_WIDTH;
+  acc->x1 = -1;
+  memset(acc->mask, 0, sizeof(acc->mask));
+}
+
+// Write the collected bank to the frame buffer
+static void 
+span_flush(span_acc_t *acc) 
+{
+  if (acc->x1 < acc->x0) return;
+
+  uint8_t *data = acc->tg->display_buffer + acc->bank * acc->tg->display_width;
+  int16_t x = acc->x0;
+  while (x <= acc->x1) {
+    // runs of whole bytes are filled at once
+    int16_t run = x;
+    while ((run <= acc->x1) && (acc->mask[run] == acc->mask[x])) run++;
+    if (acc->mask[x] != 0) {
+      apply_mask_row(data + x, run - x, acc->mask[x], acc->color);
     }
+    memset(acc->mask + x, 0, run - x);
+    x = run;
+  }
+  acc->x0 = TINYGRAFX_MAX_WIDTH;
+  acc->x1 = -1;
+}
 
-    draw_horizontal_line(tg, x0 - x, y0 - y, 2 * x, color);
-    draw_horizontal_line(tg, x0 - x, y0 + y, 2 * x, color);
-    draw_horizontal_line(tg, x0 - y, y0 - x, 2 * y, color);
-    draw_horizontal_line(tg, x0 - y, y0 + x, 2 * y, color);
-	} while (x < y);
+// Add the span x0..x1 (inclusive) of row y, relative to the origin
+static void 
+span_add(span_acc_t *acc, int16_t y, int16_t x0, int16_t x1) 
+{
+  const tinygrafx_t *tg = acc->tg;
+  y += tg->origin_y;
+  x0 += tg->origin_x;
+  x1 += tg->origin_x;
+  int16_t x_max = (tg->clip_x1 < TINYGRAFX_MAX_WIDTH) ? tg->clip_x1 : (TINYGRAFX_MAX_WIDTH - 1);
+
+  if ((y < tg->clip_y0) || (y > tg->clip_y1)) return;
+  if (x0 < tg->clip_x0) x0 = tg->clip_x0;
+  if (x1 > x_max) x1 = x_max;
+  if (x0 > x1) return;
+
+  if ((y >> 3) != acc->bank) {
+    span_flush(acc);
+    acc->bank = y >> 3;
+  }
+  uint8_t bit = 1 << (y & 7);
+  for (int16_t x = x0; x <= x1; x++) {
+    acc->mask[x] |= bit;
+  }
+  if (x0 < acc->x0) acc->x0 = x0;
+  if (x1 > acc->x1) acc->x1 = x1;
+}
+
+// Half width of the ellipse row "dy" rows from the center, the largest x
+// with x^2/rx^2 + dy^2/ry^2 <= 1, using a radius half a pixel larger.
+// "x" is the half width of the neighbouring row, the search starts there.
+// With rx and ry swapped it is the half height of a column.
+static inline int16_t 
+ellipse_half_width(int16_t rx, int16_t ry, int16_t dy, int16_t x) 
+{
+  int64_t rx2 = (int64_t)rx * rx;
+  int64_t ry2 = (int64_t)ry * ry;
+  int64_t limit = rx2 * ry2 + (int64_t)rx * ry * (rx + ry) / 2 - dy * dy * rx2;
+
+  while ((x < rx) && ((int64_t)(x + 1) * (x + 1) * ry2 <= limit)) x++;
+  while ((x > 0) && ((int64_t)x * x * ry2 > limit)) x--;
+  return x;
 }
 
-// Display a character string
 void 
-draw_char(tinygrafx_t tg, int16_t x, int16_t y, uint8_t c, int16_t color, int16_t fontsize) 
+draw_fill_circle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t r, int16_t color) 
 {
-  uint8_t row_pixel;
-  uint16_t font_width;
+  draw_fill_ellipse(tg, x0, y0, r, r, color);
+}
 
-  for (int16_t y1 = 0; y1 < tg.font_height; y1++) {  
-    row_pixel = font8x8_basic[c][y1];
+// A column is one span in the page layout, a few bytes of the frame buffer.
+// The ellipse is drawn as columns, neighbouring columns of the same height
+// as one rectangle, so every pixel is written once.
+void 
+draw_fill_ellipse(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t rx, int16_t ry, int16_t color) 
+{
+  x0 += tg->origin_x;
+  y0 += tg->origin_y;
+  if ((rx < 0) || (ry < 0)) return;
+  if ((x0 + rx < tg->clip_x0) || (x0 - rx > tg->clip_x1)) return;
+  if ((y0 + ry < tg->clip_y0) || (y0 - ry > tg->clip_y1)) return;
+
+  int16_t dx_start = (x0 - rx < tg->clip_x0) ? (tg->clip_x0 - x0) : -rx;
+  int16_t dx_end = (x0 + rx > tg->clip_x1) ? (tg->clip_x1 - x0) : rx;
+  int16_t h = (rx == 0) ? ry : ellipse_half_width(ry, rx, abs(dx_start), 0);
+  int16_t run = dx_start;
+
+  for (int16_t dx = dx_start + 1; dx <= dx_end + 1; dx++) {
+    int16_t next = -1;
+    if (dx <= dx_end) {
+      next = ellipse_half_width(ry, rx, abs(dx), h);
+    }
+    if (next != h) {
+      fill_rect_clipped(tg, x0 + run, y0 - h, dx - run, 2 * h + 1, color);
+      run = dx;
+      h = next;
+    }
+  }
+}
 
-    for (int16_t x1 = 0; x1 < tg.font_width; x1++) {
-      if (row_pixel & 0x01) {
-        if (fontsize == 1) {
-          set_pixel(tg, x + x1, y + y1, color);
-        }
-        else {
-          font_width = (fontsize & 0x01) + (fontsize / 2);
-          draw_fill_rect(tg, x + x1 * font_width, y + y1 * fontsize, font_width, fontsize, color);
+// Rectangle with corners rounded by quarter circles of radius r.
+// The corners are drawn as columns, the middle as one rectangle.
+void 
+draw_fill_round_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, int16_t color) 
+{
+  x += tg->origin_x;
+  y += tg->origin_y;
+  if ((w <= 0) || (h <= 0)) return;
+  if ((x + w <= tg->clip_x0) || (x > tg->clip_x1)) return;
+  if ((y + h <= tg->clip_y0) || (y > tg->clip_y1)) return;
+  if (r > (w - 1) / 2) r = (w - 1) / 2;
+  if (r > (h - 1) / 2) r = (h - 1) / 2;
+  if (r < 0) r = 0;
+
+  fill_rect_clipped(tg, x + r, y, w - 2 * r, h, color);
+
+  int16_t hh = 0;
+  for (int16_t dx = r; dx > 0; dx--) {
+    hh = ellipse_half_width(r, r, dx, hh);
+    int16_t inset = r - hh;
+    fill_rect_clipped(tg, x + r - dx, y + inset, 1, h - 2 * inset, color);
+    fill_rect_clipped(tg, x + w - 1 - r + dx, y + inset, 1, h - 2 * inset, color);
+  }
+}
+
+// a / b rounded down, b > 0
+static inline int32_t 
+floor_div(int32_t a, int32_t b) 
+{
+  return (a >= 0) ? (a / b) : -((b - 1 - a) / b);
+}
+
+// x of the edge (xa, ya)-(xb, yb) at y2 / 2, rounded to the nearest pixel.
+// ya < yb.
+static inline int16_t 
+edge_x(int16_t xa, int16_t ya, int16_t xb, int16_t yb, int32_t y2) 
+{
+  int32_t num = (y2 - 2 * ya) * (int32_t)(xb - xa);
+  int32_t den = 2 * (int32_t)(yb - ya);
+  return xa + floor_div(2 * num + den, 2 * den);
+}
+
+// Filled polygon, even-odd rule. Points are x, y pairs.
+// Each row is the interior between the edge crossings at the row center,
+// plus the pixels the edges pass through, so the fill covers its outline.
+void 
+draw_fill_polygon(const tinygrafx_t *tg, const int16_t *points, int16_t n, int16_t color) 
+{
+  span_acc_t acc;
+  int32_t cross[TINYGRAFX_POLYGON_MAX];   // 16.16 fixed point
+  int16_t y_min, y_max, x_min, x_max;
+
+  if ((n < 1) || (n > TINYGRAFX_POLYGON_MAX)) return;
+
+  x_min = x_max = points[0];
+  y_min = y_max = points[1];
+  for (int16_t i = 1; i < n; i++) {
+    if (points[2 * i] < x_min) x_min = points[2 * i];
+    if (points[2 * i] > x_max) x_max = points[2 * i];
+    if (points[2 * i + 1] < y_min) y_min = points[2 * i + 1];
+    if (points[2 * i + 1] > y_max) y_max = points[2 * i + 1];
+  }
+  if ((x_max + tg->origin_x < tg->clip_x0) || (x_min + tg->origin_x > tg->clip_x1)) return;
+  if ((y_max + tg->origin_y < tg->clip_y0) || (y_min + tg->origin_y > tg->clip_y1)) return;
+  if (y_min + tg->origin_y < tg->clip_y0) y_min = tg->clip_y0 - tg->origin_y;
+  if (y_max + tg->origin_y > tg->clip_y1) y_max = tg->clip_y1 - tg->origin_y;
+
+  span_begin(&acc, tg, color);
+  for (int16_t y = y_min; y <= y_max; y++) {
+    int16_t count = 0;
+
+    for (int16_t i = 0; i < n; i++) {
+      int16_t j = (i + 1) % n;
+      int16_t xa = points[2 * i], ya = points[2 * i + 1];
+      int16_t xb = points[2 * j], yb = points[2 * j + 1];
+      if (ya > yb) {
+        swap_int16_t(xa, xb);
+        swap_int16_t(ya, yb);
+      }
+      if ((y < ya) || (y > yb)) continue;
+
+      // the pixels of the edge in this row
+      if (ya == yb) {
+        span_add(&acc, y, (xa < xb) ? xa : xb, (xa < xb) ? xb : xa);
+        continue;
+      }
+      int32_t top = (2 * y - 1 > 2 * ya) ? (2 * y - 1) : (2 * ya);
+      int32_t bottom = (2 * y + 1 < 2 * yb) ? (2 * y + 1) : (2 * yb);
+      int16_t ex0 = edge_x(xa, ya, xb, yb, top);
+      int16_t ex1 = edge_x(xa, ya, xb, yb, bottom);
+      span_add(&acc, y, (ex0 < ex1) ? ex0 : ex1, (ex0 < ex1) ? ex1 : ex0);
+
+      // crossing of the row center, the lower end of the edge excluded
+      if (y < yb) {
+        int32_t c = (int32_t)xa * 65536 + (int32_t)((int64_t)(y - ya) * (xb - xa) * 65536 / (yb - ya));
+        int16_t k = count++;
+        while ((k > 0) && (cross[k - 1] > c)) {
+          cross[k] = cross[k - 1];
+          k--;
         }
+        cross[k] = c;
       }
-      row_pixel >>= 1;
+    }
+
+    // the interior between pairs of crossings
+    for (int16_t k = 0; k + 1 < count; k += 2) {
+      int16_t x0 = (cross[k] + 0xFFFF) >> 16;
+      int16_t x1 = cross[k + 1] >> 16;
+      span_add(&acc, y, x0, x1);
     }
   }
-  // ESP_LOGI(TAG, "draw char: 0x%X=%c", c, c);
+  span_flush(&acc);
 }
 
 void 
-display_text(tinygrafx_t tg, int16_t x, int16_t y, uint8_t *text, int16_t length, int16_t color, int16_t fontsize) 
+draw_fill_triangle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t color) 
 {
-  // ESP_LOGI(TAG, "display text: %s, length: %d, fontsize: %d", text, length, fontsize);
-  uint16_t font_width;
+  int16_t points[] = { x0, y0, x1, y1, x2, y2 };
+  draw_fill_polygon(tg, points, 3, color);
+}
+
+// Combine the source byte with a byte of the frame buffer.
+// "bits" selects the pixels covered by the source.
+static inline void 
+blit_byte(uint8_t *data, uint8_t src, uint8_t bits, int16_t rop) 
+{
+  switch (rop) {
+    case BLIT_COPY:
+    case BLIT_MASKED: *data = (*data & ~bits) | (src & bits); break;
+    case BLIT_OR:     *data |=  (src & bits); break;
+    case BLIT_AND:    *data &=  (src | ~bits); break;
+    case BLIT_XOR:    *data ^=  (src & bits); break;
+    case BLIT_ERASE:  *data &= ~(src & bits); break;
+  }
+}
+
+// Rows of the bank inside the clip rectangle
+static inline uint8_t 
+clip_bank_mask(const tinygrafx_t *tg, int16_t bank) 
+{
+  int16_t top = tg->clip_y0 - bank * 8;
+  int16_t bottom = tg->clip_y1 - bank * 8;
+  uint8_t mask = 0xFF;
+
+  if ((top > 7) || (bottom < 0)) return 0;
+  if (top > 0) mask &= 0xFF << top;
+  if (bottom < 7) mask &= 0xFF >> (7 - bottom);
+  return mask;
+}
+
+// Draw a column of 8 source pixels into the bank at "data" and the next one.
+// "bits" are the pixels covered, shifted down by the row of the top pixel
+// and clipped.
+CORE void 
+blit_column(int16_t width, uint8_t *data, uint16_t src, uint16_t bits, int16_t rop) 
+{
+  if (bits & 0x00FF) {
+    blit_byte(data, src, bits, rop);
+  }
+  if (bits & 0xFF00) {
+    blit_byte(data + width, src >> 8, bits >> 8, rop);
+  }
+}
+
+CORE void 
+blit_core(const tinygrafx_t *tg, int16_t width, int16_t x, int16_t y, const uint8_t *bitmap, const uint8_t *mask, int16_t w, int16_t h, int16_t rop) 
+{
+  x += tg->origin_x;
+  y += tg->origin_y;
+
+  int16_t x_start = (x < tg->clip_x0) ? (tg->clip_x0 - x) : 0;
+  int16_t x_end = (x + w - 1 > tg->clip_x1) ? (tg->clip_x1 - x + 1) : w;
+  int16_t src_banks = (h + 7) / 8;
+
+  if ((x_start >= x_end) || (h <= 0)) return;
+  if ((y + h <= tg->clip_y0) || (y > tg->clip_y1)) return;
+  if ((rop == BLIT_MASKED) && (mask == NULL)) {
+    rop = BLIT_COPY;
+  }
+
+  for (int16_t sb = 0; sb < src_banks; sb++) {
+    int16_t dy = y + sb * 8;
+    uint8_t bits = ((h - sb * 8) < 8) ? (0xFF >> (8 - (h - sb * 8))) : 0xFF;
+
+    if ((dy + 8 <= tg->clip_y0) || (dy > tg->clip_y1)) continue;
+
+    // the destination banks of the source bank, and their visible rows
+    int16_t bank = (dy >= 0) ? (dy / 8) : -((7 - dy) / 8);
+    int16_t shift = dy - bank * 8;
+    uint16_t clip = clip_bank_mask(tg, bank) | (clip_bank_mask(tg, bank + 1) << 8);
+    uint16_t covered = ((uint16_t)bits << shift) & clip;
+    uint8_t *data = tg->display_buffer + x + bank * width;
 
-  for (int16_t i = 0; i < length; i++) {
-    if (text[i] == '\n') {
-      x =0;
-      y += tg.font_width * fontsize;
+    const uint8_t *src = bitmap + sb * w;
+    for (int16_t i = x_start; i < x_end; i++) {
+      uint16_t b = (rop == BLIT_MASKED) ? (((uint16_t)mask[i + sb * w] << shift) & covered) : covered;
+      blit_column(width, data + i, (uint16_t)src[i] << shift, b, rop);
+    }
+  }
+}
+
+void 
+blit(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *bitmap, const uint8_t *mask, int16_t w, int16_t h, int16_t rop) 
+{
+  WITH_GEOMETRY(tg, blit_core(tg, width, x, y, bitmap, mask, w, h, rop));
+}
+
+// Scroll the pixels of the region by dx columns and dy rows.
+// Columns move as byte runs of each bank; rows move as bit shifts across
+// the banks, carrying the bits of the neighbouring bank. Pixels moved out
+// of the region are dropped, the vacated area is filled with "color".
+
+// Move the columns of the bank rows in "mask" by dx
+static void 
+scroll_bank_columns(uint8_t *row, int16_t x0, int16_t x1, int16_t dx, uint8_t mask, int16_t color) 
+{
+  int16_t w = x1 - x0 + 1;
+  int16_t moved = w - abs(dx);
+
+  if (mask == 0xFF) {
+    if (dx > 0) {
+      memmove(row + x0 + dx, row + x0, moved);
+      apply_mask_row(row + x0, dx, 0xFF, color);
     }
     else {
-      draw_char(tg, x, y, text[i], color, fontsize);
-      if (fontsize == 1) {
-        x += tg.font_width * fontsize;
+      memmove(row + x0, row + x0 - dx, moved);
+      apply_mask_row(row + x1 + dx + 1, -dx, 0xFF, color);
+    }
+    return;
+  }
+  if (dx > 0) {
+    for (int16_t x = x1; x >= x0 + dx; x--) {
+      row[x] = (row[x] & ~mask) | (row[x - dx] & mask);
+    }
+    apply_mask_row(row + x0, dx, mask, color);
+  }
+  else {
+    for (int16_t x = x0; x <= x1 + dx; x++) {
+      row[x] = (row[x] & ~mask) | (row[x - dx] & mask);
+    }
+    apply_mask_row(row + x1 + dx + 1, -dx, mask, color);
+  }
+}
+
+// Rows y0..y1 of the bank, as a mask
+static inline uint8_t 
+rows_bank_mask(int16_t y0, int16_t y1, int16_t bank) 
+{
+  int16_t top = y0 - bank * 8;
+  int16_t bottom = y1 - bank * 8;
+  uint8_t mask = 0xFF;
+
+  if ((top > 7) || (bottom < 0) || (y1 < y0)) return 0;
+  if (top > 0) mask &= 0xFF << top;
+  if (bottom < 7) mask &= 0xFF >> (7 - bottom);
+  return mask;
+}
+
+// Move the rows of columns x0..x1 by dy. A destination bank takes its bits
+// from at most two source banks.
+static void 
+scroll_rows(const tinygrafx_t *tg, int16_t x0, int16_t x1, int16_t y0, int16_t y1, int16_t dy, int16_t color) 
+{
+  int16_t banks = (tg->display_height + 7) / 8;
+  int16_t first = y0 / 8, last = y1 / 8;
+  int16_t step = (dy > 0) ? -1 : 1;
+
+  // with dy > 0 the bits come from above, go upwards so they are read first
+  for (int16_t b = (dy > 0) ? last : first; (b >= first) && (b <= last); b += step) {
+    uint8_t mask = rows_bank_mask(y0, y1, b);
+    uint8_t moved = mask & rows_bank_mask(y0 + dy, y1 + dy, b);
+    int16_t src = 8 * b - dy;
+    int16_t sb = (src >= 0) ? (src / 8) : -((7 - src) / 8);
+    int16_t shift = src - sb * 8;
+    uint8_t *dst = tg->display_buffer + b * tg->display_width;
+    const uint8_t *lo = ((sb >= 0) && (sb < banks)) ? (tg->display_buffer + sb * tg->display_width) : NULL;
+    const uint8_t *hi = ((sb + 1 >= 0) && (sb + 1 < banks)) ? (tg->display_buffer + (sb + 1) * tg->display_width) : NULL;
+
+    if ((moved == 0xFF) && (shift == 0) && lo) {
+      memmove(dst + x0, lo + x0, x1 - x0 + 1);
+    }
+    else if ((moved == 0xFF) && lo && hi) {
+      for (int16_t x = x0; x <= x1; x++) {
+        dst[x] = (lo[x] >> shift) | (hi[x] << (8 - shift));
       }
-      else {
-        font_width = (fontsize & 0x01) + (fontsize / 2);
-        x += tg.font_width * font_width;
+    }
+    else {
+      for (int16_t x = x0; x <= x1; x++) {
+        uint16_t bits = (lo ? lo[x] : 0) | ((hi ? hi[x] : 0) << 8);
+        uint8_t value = bits >> shift;
+        dst[x] = (dst[x] & ~moved) | (value & moved);
       }
     }
+    if (mask & ~moved) {
+      apply_mask_row(dst + x0, x1 - x0 + 1, mask & ~moved, color);
+    }
+  }
+}
+
+void 
+scroll_region(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy, int16_t color) 
+{
+  int32_t x0 = (int32_t)x + tg->origin_x, y0 = (int32_t)y + tg->origin_y;
+  int32_t x1 = x0 + w - 1, y1 = y0 + h - 1;
+
+  if (x0 < tg->clip_x0) x0 = tg->clip_x0;
+  if (y0 < tg->clip_y0) y0 = tg->clip_y0;
+  if (x1 > tg->clip_x1) x1 = tg->clip_x1;
+  if (y1 > tg->clip_y1) y1 = tg->clip_y1;
+  if ((x0 > x1) || (y0 > y1) || ((dx == 0) && (dy == 0))) return;
+
+  // moved out entirely
+  if ((abs(dx) > x1 - x0) || (abs(dy) > y1 - y0)) {
+    fill_rect_clipped(tg, x0, y0, x1 - x0 + 1, y1 - y0 + 1, color);
+    return;
+  }
+
+  if (dx != 0) {
+    for (int16_t b = y0 / 8; b <= y1 / 8; b++) {
+      scroll_bank_columns(tg->display_buffer + b * tg->display_width, x0, x1, dx, rows_bank_mask(y0, y1, b), color);
+    }
+  }
+  if (dy != 0) {
+    scroll_rows(tg, x0, x1, y0, y1, dy, color);
+  }
+}
+
+// Scroll the clip rectangle, the whole display unless it is clipped
+void 
+scroll(const tinygrafx_t *tg, int16_t dx, int16_t dy, int16_t color) 
+{
+  scroll_region(tg, tg->clip_x0 - tg->origin_x, tg->clip_y0 - tg->origin_y, 
+                tg->clip_x1 - tg->clip_x0 + 1, tg->clip_y1 - tg->clip_y0 + 1, dx, dy, color);
+}
+
+// Display a character string
+
+// Glyphs scaled up for fontsize > 1 are cached on first use.
+// Cache entries hold glyphs up to GLYPH_CACHE_FONTSIZE.
+#define GLYPH_CACHE_SIZE      32
+#define GLYPH_CACHE_FONTSIZE  4
+#define GLYPH_SCALE_X(fontsize) (((fontsize) & 0x01) + ((fontsize) / 2))
+#define GLYPH_SIZE(fontsize)  (8 * GLYPH_SCALE_X(fontsize) * (fontsize))
+
+typedef struct glyph_cache_t {
+  const uint8_t *glyph;     // 8x8 glyph in the page layout
+  uint8_t fontsize;         // 0 = empty entry
+  uint8_t data[GLYPH_SIZE(GLYPH_CACHE_FONTSIZE)];
+} glyph_cache_t;
+
+static glyph_cache_t glyph_cache[GLYPH_CACHE_SIZE];
+
+// Scale up the glyph, fontsize rows and (fontsize / 2) columns per pixel.
+// The result is a bitmap of 8 * scale_x columns and fontsize banks.
+static void 
+scale_glyph(const uint8_t *glyph, int16_t fontsize, uint8_t *data) 
+{
+  int16_t scale_x = GLYPH_SCALE_X(fontsize);
+  int16_t w = 8 * scale_x;
+  uint64_t rows = (1ULL << fontsize) - 1;
+
+  for (int16_t x1 = 0; x1 < 8; x1++) {
+    uint8_t src = glyph[x1];
+    uint64_t column = 0;
+
+    for (int16_t y1 = 0; y1 < 8; y1++) {
+      if (src & (1 << y1)) {
+        column |= rows << (y1 * fontsize);
+      }
+    }
+    for (int16_t bank = 0; bank < fontsize; bank++) {
+      memset(data + x1 * scale_x + bank * w, (uint8_t)(column >> (bank * 8)), scale_x);
+    }
+  }
+}
+
+static const uint8_t *
+cached_glyph(const uint8_t *glyph, int16_t fontsize) 
+{
+  glyph_cache_t *entry = &glyph_cache[((uintptr_t)glyph / 8 * 7 + fontsize) % GLYPH_CACHE_SIZE];
+
+  if ((entry->glyph != glyph) || (entry->fontsize != fontsize)) {
+    scale_glyph(glyph, fontsize, entry->data);
+    entry->glyph = glyph;
+    entry->fontsize = fontsize;
+  }
+  return entry->data;
+}
+
+// Draw an 8x8 glyph of the page layout scaled by fontsize
+static void 
+draw_glyph(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *glyph, int16_t color, int16_t fontsize) 
+{
+  int16_t rop;
+
+  switch (color) {
+    case WHITE: rop = BLIT_OR; break;
+    case BLACK: rop = BLIT_ERASE; break;
+    case INVERT:rop = BLIT_XOR; break;
+    default: return;
+  }
+
+  if (fontsize == 1) {
+    blit(tg, x, y, glyph, NULL, 8, 8, rop);
+  }
+  else if (fontsize <= GLYPH_CACHE_FONTSIZE) {
+    blit(tg, x, y, cached_glyph(glyph, fontsize), NULL, 8 * GLYPH_SCALE_X(fontsize), 8 * fontsize, rop);
+  }
+  else if (fontsize <= 8) {
+    uint8_t data[GLYPH_SIZE(8)];
+    scale_glyph(glyph, fontsize, data);
+    blit(tg, x, y, data, NULL, 8 * GLYPH_SCALE_X(fontsize), 8 * fontsize, rop);
+  }
+  else {
+    uint16_t font_width = GLYPH_SCALE_X(fontsize);
+    for (int16_t x1 = 0; x1 < 8; x1++) {
+      uint8_t column = glyph[x1];
+      for (int16_t y1 = 0; y1 < 8; y1++) {
+        if (column & (1 << y1)) {
+          draw_fill_rect(tg, x + x1 * font_width, y + y1 * fontsize, font_width, fontsize, color);
+        }
+      }
+    }
+  }
+}
+
+void 
+draw_char(const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t c, int16_t color, int16_t fontsize) 
+{
+  if (c >= 128) return;
+
+  draw_glyph(tg, x, y, FONT8X8_GLYPH(c), color, fontsize);
+  // ESP_LOGI(TAG, "draw char: 0x%X=%c", c, c);
+}
+
+// UTF-8 text in the 8x8 font, decoded like font_draw_text: a missing
+// character is drawn as the fallback glyph
+void 
+display_text(const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t *text, int16_t length, int16_t color, int16_t fontsize) 
+{
+  // ESP_LOGI(TAG, "display text: %s, length: %d, fontsize: %d", text, length, fontsize);
+  const uint8_t *cur = text;
+  const uint8_t *end = text + length;
+  int16_t scale_x = GLYPH_SCALE_X(fontsize);
+  int16_t x0 = x;
+
+  while (cur < end) {
+    uint32_t codepoint = utf8_next(&cur, end);
+    const uint8_t *glyph;
+    int16_t width;
+
+    if (codepoint == '\n') {
+      x = x0;
+      y += font_8x8.line_height * fontsize;
+      continue;
+    }
+    if (!font_draw_glyph(&font_8x8, codepoint, &glyph, &width)) continue;
+
+    draw_glyph(tg, x, y, glyph, color, fontsize);
+    x += (width + font_8x8.spacing) * scale_x;
   }
 }
 
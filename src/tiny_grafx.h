@@ -1,6 +1,8 @@
 #ifndef TINYGRAFXH_
 #define TINYGRAFXH_
 
+#include <stdint.h>
+
 // TINYGRAFX config
 typedef struct tinygrafx_t {
   uint16_t display_width;
@@ -9,29 +11,79 @@ typedef struct tinygrafx_t {
   uint8_t font_width;
   uint8_t font_height;
   uint8_t *display_buffer;
+  int16_t origin_x;         // drawing origin, added to the coordinates
+  int16_t origin_y;
+  int16_t clip_x0;          // clip rectangle in display coordinates (inclusive)
+  int16_t clip_y0;
+  int16_t clip_x1;
+  int16_t clip_y1;
 } tinygrafx_t;
 
 #define BLACK   0
 #define WHITE   1
 #define INVERT  2
 
-// manipulate the graphics
+// raster operations of blit
+#define BLIT_COPY   0   // replace the pixels
+#define BLIT_OR     1   // set the pixels set in the bitmap
+#define BLIT_AND    2   // clear the pixels cleared in the bitmap
+#define BLIT_XOR    3   // invert the pixels set in the bitmap
+#define BLIT_ERASE  4   // clear the pixels set in the bitmap
+#define BLIT_MASKED 5   // replace the pixels set in the mask
+
+// Widest frame buffer the span rasterizer fills
+#define TINYGRAFX_MAX_WIDTH   128
+
+// Most points of a filled polygon
+#define TINYGRAFX_POLYGON_MAX 64
+
+// Fixed panel geometry. Building with TINYGRAFX_FIXED_WIDTH and
+// TINYGRAFX_FIXED_HEIGHT defined (e.g. 84 and 48) specialises the raster
+// core for frame buffers of that size, frame buffers of other sizes take
+// the generic code.
+#if defined(TINYGRAFX_FIXED_WIDTH) != defined(TINYGRAFX_FIXED_HEIGHT)
+#error "define both TINYGRAFX_FIXED_WIDTH and TINYGRAFX_FIXED_HEIGHT"
+#endif
+
+// manipulate the graphics, the config is passed by reference
 #define swap_int16_t(a, b) { int16_t t = a; a = b; b = t; }
 
-void buffer_clear(tinygrafx_t tg);
-void buffer_read(tinygrafx_t tg, uint8_t *data, int16_t size);
-void set_pixel(tinygrafx_t tg, int16_t x, int16_t y, uint16_t color) ;
-int16_t get_pixel(tinygrafx_t tg, int16_t x, int16_t y);
-void draw_line(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t color);
-void draw_vertical_line(tinygrafx_t tg, int16_t x, int16_t y, int16_t h, int16_t color);
-void draw_horizontal_line(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t color);
-void draw_rect(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color);
-void draw_fill_rect(tinygrafx_t tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color);
-void draw_circle(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t r, int16_t color);
-void draw_fill_circle(tinygrafx_t tg, int16_t x0, int16_t y0, int16_t r, int16_t color);
-
-// Display a character string
-void draw_char(tinygrafx_t tg, int16_t x, int16_t y, uint8_t c, int16_t color, int16_t fontsize);
-void display_text(tinygrafx_t tg, int16_t x, int16_t y, uint8_t *text, int16_t length, int16_t color, int16_t fontsize);
+// Clip rectangle and drawing origin.
+// The clip rectangle is in display coordinates, the origin is added to the
+// coordinates of every primitive. buffer_clear ignores the clip rectangle.
+void set_clip(tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h);
+void reset_clip(tinygrafx_t *tg);
+void set_origin(tinygrafx_t *tg, int16_t x, int16_t y);
+
+void buffer_clear(const tinygrafx_t *tg);
+void buffer_read(const tinygrafx_t *tg, uint8_t *data, int16_t size);
+void set_pixel(const tinygrafx_t *tg, int16_t x, int16_t y, uint16_t color) ;
+int16_t get_pixel(const tinygrafx_t *tg, int16_t x, int16_t y);
+void draw_line(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t color);
+void draw_vertical_line(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t h, int16_t color);
+void draw_horizontal_line(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t color);
+void draw_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color);
+void draw_fill_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t color);
+void draw_circle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t r, int16_t color);
+void draw_fill_circle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t r, int16_t color);
+
+// Filled shapes, drawn as spans covering each pixel once
+void draw_fill_ellipse(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t rx, int16_t ry, int16_t color);
+void draw_fill_round_rect(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, int16_t color);
+void draw_fill_triangle(const tinygrafx_t *tg, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t color);
+void draw_fill_polygon(const tinygrafx_t *tg, const int16_t *points, int16_t n, int16_t color);
+
+// Draw a 1bpp bitmap in the page layout of the frame buffer.
+// Each byte is a column of 8 pixels (LSB on top), w bytes per bank.
+void blit(const tinygrafx_t *tg, int16_t x, int16_t y, const uint8_t *bitmap, const uint8_t *mask, int16_t w, int16_t h, int16_t rop);
+
+// Move the pixels of a region, or of the clip rectangle, by dx and dy.
+// The vacated area is filled with color.
+void scroll_region(const tinygrafx_t *tg, int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy, int16_t color);
+void scroll(const tinygrafx_t *tg, int16_t dx, int16_t dy, int16_t color);
+
+// Display a character string, a line feed starts a new line at x
+void draw_char(const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t c, int16_t color, int16_t fontsize);
+void display_text(const tinygrafx_t *tg, int16_t x, int16_t y, uint8_t *text, int16_t length, int16_t color, int16_t fontsize);
 
 #endif /* TINYGRAFXH_ */